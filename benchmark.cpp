@@ -0,0 +1,562 @@
+// Problem generators and timing harness for the planner.
+//
+// Build:  g++ -O2 -std=c++17 -o benchmark benchmark.cpp
+//
+// Usage:
+//   benchmark blocksworld <num_blocks> [seed]             print a blocksworld problem
+//   benchmark fire <num_fires> <num_locations> [seed]     print a fire fighting problem
+//   benchmark run <planner> [max_size] [timeout] [-c "<planner args>"]...
+//   benchmark compare <planner> [max_size] [timeout] -c "<reference args>" -c "<planner args>"...
+//
+// "run" generates instances of increasing size for both domains, runs the planner
+// binary once per instance and configuration and prints one CSV row per run.
+// Every returned plan is replayed against its problem; a plan that does not reach
+// the goal is reported as "invalid" and makes "run" exit with status 1.
+// A configuration stops growing once it fails or times out at some size, so the
+// last row of each configuration marks its scaling cliff.
+//
+// "compare" runs the same suite but checks plan costs against the first configuration,
+// for instance an optimal search against A* with an admissible heuristic:
+//   benchmark compare ./planner 6 60 -c "2" -c "2 --search=sma --memory-budget=1M"
+// A solved instance whose plan length differs from the reference's is reported as
+// "cost_mismatch" and makes "compare" exit with status 1.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <map>
+#include <set>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+string blocksworldDomain()
+{
+    return "Actions:\n"
+           "        MoveToTable(b,x)\n"
+           "        Preconditions: On(b,x), Clear(b), Block(b), Block(x)\n"
+           "        Effects: On(b,Table), Clear(x), !On(b,x)\n"
+           "\n"
+           "        Move(b,x,y)\n"
+           "        Preconditions: On(b,x), Clear(b), Clear(y), Block(b), Block(y)\n"
+           "        Effects: On(b,y), Clear(x), !On(b,x), !Clear(y)\n";
+}
+
+string fireDomain()
+{
+    return "Actions:\n"
+           "        Extinguish(x,y,z)\n"
+           "        Preconditions: At(x,z),InAir(x), Fire(z),FullTank(x),FullBattery(x),UAV(x),MobileRobot(y),At(y,z)\n"
+           "        Effects: !Fire(z), EmptyTank(x), EmptyBattery(x), ExtinguishedFire(z), !FullBattery(x),!FullTank(x)\n"
+           "\n"
+           "        Land(x,y,z)\n"
+           "        Preconditions: InAir(x), At(x,z), At(y,z),UAV(x),MobileRobot(y)\n"
+           "        Effects: On(x,y),FullBattery(x),!EmptyBattery(x),!InAir(x)\n"
+           "\n"
+           "        Takeoff(x,y)\n"
+           "        Preconditions: UAV(x),MobileRobot(y),On(x,y),FullBattery(x), FullTank(x)\n"
+           "        Effects: !On(x,y), InAir(x)\n"
+           "\n"
+           "        Move(x,y,z,w)\n"
+           "        Preconditions: UAV(x), MobileRobot(y), On(x,y),At(x,w),At(y,w)\n"
+           "        Effects: At(x,z),At(y,z),!At(x,w),!At(y,w)\n"
+           "\n"
+           "        MoveUGV(x,y,z,w)\n"
+           "        Preconditions: UAV(x),MobileRobot(y),InAir(x), At(x,z),At(y,w)\n"
+           "        Effects: At(y,z),!At(y,w)\n"
+           "\n"
+           "        FillTank(x,y,z)\n"
+           "        Preconditions: UAV(x),MobileRobot(y),On(x,y),EmptyTank(x),At(x,z),At(y,z),Water(z)\n"
+           "        Effects: !EmptyTank(x),FullTank(x)\n";
+}
+
+string joinConditions(const vector<string> &conditions)
+{
+    string joined;
+    for (size_t i = 0; i < conditions.size(); i++)
+    {
+        if (i > 0)
+            joined += ", ";
+        joined += conditions[i];
+    }
+    return joined;
+}
+
+// Random towers over the given blocks as On(...) atoms, plus the Clear(...) atoms of the tops.
+void randomTowers(const vector<string> &blocks, mt19937 &rng, vector<string> &on, vector<string> &clear)
+{
+    vector<string> order = blocks;
+    shuffle(order.begin(), order.end(), rng);
+    vector<string> tops;
+    for (const string &block : order)
+    {
+        uniform_int_distribution<size_t> pick(0, tops.size());
+        size_t stack = pick(rng);
+        if (stack == tops.size())
+        {
+            on.push_back("On(" + block + ",Table)");
+            tops.push_back(block);
+        }
+        else
+        {
+            on.push_back("On(" + block + "," + tops[stack] + ")");
+            tops[stack] = block;
+        }
+    }
+    for (const string &top : tops)
+        clear.push_back("Clear(" + top + ")");
+}
+
+string generateBlocksworld(int num_blocks, unsigned seed)
+{
+    mt19937 rng(seed);
+    vector<string> blocks;
+    for (int i = 0; i < num_blocks; i++)
+        blocks.push_back("B" + to_string(i));
+
+    vector<string> initial;
+    vector<string> clear;
+    randomTowers(blocks, rng, initial, clear);
+    initial.insert(initial.end(), clear.begin(), clear.end());
+    for (const string &block : blocks)
+        initial.push_back("Block(" + block + ")");
+
+    vector<string> goal;
+    vector<string> goal_clear;
+    randomTowers(blocks, rng, goal, goal_clear);
+
+    vector<string> symbols = blocks;
+    symbols.push_back("Table");
+
+    stringstream problem;
+    problem << "Symbols: " << joinConditions(symbols) << "\n";
+    problem << "Initial conditions: " << joinConditions(initial) << "\n";
+    problem << "Goal conditions: " << joinConditions(goal) << "\n\n";
+    problem << blocksworldDomain();
+    return problem.str();
+}
+
+string generateFire(int num_fires, int num_locations, unsigned seed)
+{
+    mt19937 rng(seed);
+    vector<string> locations;
+    for (int i = 0; i < num_locations; i++)
+        locations.push_back("L" + to_string(i));
+    vector<string> fires;
+    for (int i = 0; i < num_fires; i++)
+        fires.push_back("F" + to_string(i));
+
+    // The UAV and the robot start at plain locations. No action refers to a location
+    // predicate, so only the two start locations become symbols; the others would only
+    // multiply the grounded moves.
+    uniform_int_distribution<int> pick(0, num_locations - 1);
+    vector<string> initial = {"UAV(U)", "MobileRobot(M)", "InAir(U)", "Water(W)", "EmptyBattery(U)", "EmptyTank(U)"};
+    string uav_location = locations[pick(rng)];
+    string robot_location = locations[pick(rng)];
+    initial.push_back("At(U," + uav_location + ")");
+    initial.push_back("At(M," + robot_location + ")");
+    for (const string &fire : fires)
+        initial.push_back("Fire(" + fire + ")");
+
+    vector<string> goal;
+    for (const string &fire : fires)
+        goal.push_back("ExtinguishedFire(" + fire + ")");
+
+    vector<string> symbols = {uav_location};
+    if (robot_location != uav_location)
+        symbols.push_back(robot_location);
+    symbols.insert(symbols.end(), fires.begin(), fires.end());
+    symbols.push_back("W");
+    symbols.push_back("U");
+    symbols.push_back("M");
+
+    stringstream problem;
+    problem << "Symbols: " << joinConditions(symbols) << "\n";
+    problem << "Initial conditions: " << joinConditions(initial) << "\n";
+    problem << "Goal conditions: " << joinConditions(goal) << "\n\n";
+    problem << fireDomain();
+    return problem.str();
+}
+
+// Conditions of a list such as "On(b,x), Clear(b)"; commas inside parentheses separate
+// arguments. Whitespace is dropped.
+vector<string> splitConditions(const string &text)
+{
+    vector<string> conditions;
+    string condition;
+    int depth = 0;
+    for (char c : text)
+    {
+        if (c == '(')
+            depth++;
+        else if (c == ')')
+            depth--;
+        if (c == ',' && depth == 0)
+        {
+            if (!condition.empty())
+                conditions.push_back(condition);
+            condition.clear();
+        }
+        else if (!isspace((unsigned char)c))
+            condition += c;
+    }
+    if (!condition.empty())
+        conditions.push_back(condition);
+    return conditions;
+}
+
+// Splits "Name(a,b)" into its name and arguments.
+void splitAtom(const string &atom, string &name, vector<string> &arguments)
+{
+    size_t open = atom.find('(');
+    name = atom.substr(0, open);
+    arguments.clear();
+    if (open == string::npos)
+        return;
+    string argument;
+    for (size_t i = open + 1; i < atom.size() && atom[i] != ')'; i++)
+    {
+        if (atom[i] == ',')
+        {
+            arguments.push_back(argument);
+            argument.clear();
+        }
+        else
+            argument += atom[i];
+    }
+    arguments.push_back(argument);
+}
+
+struct ActionSchema
+{
+    vector<string> parameters;
+    vector<string> preconditions;
+    vector<string> effects;
+};
+
+// `condition` with its parameters replaced by their bound symbols; other arguments are constants.
+string bindCondition(const string &condition, const map<string, string> &binding)
+{
+    string name;
+    vector<string> arguments;
+    splitAtom(condition, name, arguments);
+    string bound = name + "(";
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+        auto value = binding.find(arguments[i]);
+        bound += (i > 0 ? "," : "") + (value != binding.end() ? value->second : arguments[i]);
+    }
+    return bound + ")";
+}
+
+bool holds(const set<string> &state, const string &condition)
+{
+    if (condition[0] == '!')
+        return state.count(condition.substr(1)) == 0;
+    return state.count(condition) > 0;
+}
+
+// Replays the plan printed in `output` from the initial state of `problem`. False if a step
+// is unknown or not applicable, or if the goal does not hold after the last step.
+bool validatePlan(const string &problem, const string &output)
+{
+    set<string> state;
+    vector<string> goal;
+    map<string, ActionSchema> schemas;
+    stringstream problem_lines(problem);
+    string line;
+    ActionSchema *schema = nullptr; // the one whose header was read last
+    while (getline(problem_lines, line))
+    {
+        line.erase(0, line.find_first_not_of(" \t"));
+        size_t colon = line.find(':');
+        string key = line.substr(0, colon);
+        vector<string> conditions = colon == string::npos ? vector<string>() : splitConditions(line.substr(colon + 1));
+        if (key == "Initial conditions")
+            state.insert(conditions.begin(), conditions.end());
+        else if (key == "Goal conditions")
+            goal = conditions;
+        else if (key == "Preconditions" && schema != nullptr)
+            schema->preconditions = conditions;
+        else if (key == "Effects" && schema != nullptr)
+            schema->effects = conditions;
+        else if (colon == string::npos && line.find('(') != string::npos)
+        {
+            string name;
+            vector<string> parameters;
+            splitAtom(splitConditions(line).front(), name, parameters);
+            schema = &schemas[name];
+            schema->parameters = parameters;
+        }
+    }
+
+    stringstream output_lines(output);
+    bool in_plan = false;
+    while (getline(output_lines, line))
+    {
+        vector<string> step = splitConditions(line);
+        if (!in_plan)
+        {
+            in_plan = line.compare(0, 5, "Plan:") == 0;
+            continue;
+        }
+        if (step.empty())
+            break;
+        string name;
+        vector<string> arguments;
+        splitAtom(step.front(), name, arguments);
+        auto schema = schemas.find(name);
+        if (schema == schemas.end() || schema->second.parameters.size() != arguments.size())
+            return false;
+        map<string, string> binding;
+        for (size_t i = 0; i < arguments.size(); i++)
+            binding[schema->second.parameters[i]] = arguments[i];
+        for (const string &precondition : schema->second.preconditions)
+            if (!holds(state, precondition[0] == '!' ? "!" + bindCondition(precondition.substr(1), binding)
+                                                      : bindCondition(precondition, binding)))
+                return false;
+        // Deletes before adds, as the planner applies them.
+        for (const string &effect : schema->second.effects)
+            if (effect[0] == '!')
+                state.erase(bindCondition(effect.substr(1), binding));
+        for (const string &effect : schema->second.effects)
+            if (effect[0] != '!')
+                state.insert(bindCondition(effect, binding));
+    }
+    if (!in_plan)
+        return false;
+    for (const string &condition : goal)
+        if (!holds(state, condition))
+            return false;
+    return true;
+}
+
+struct RunResult
+{
+    string status = "error";
+    double grounding_time = -1;
+    double plan_time = -1;
+    long expanded = -1;
+    long plan_length = -1;
+    long peak_memory_kb = -1;
+};
+
+// Value following `key` on the first line of `output` that starts with it.
+bool findValue(const string &output, const string &key, string &value)
+{
+    stringstream lines(output);
+    string line;
+    while (getline(lines, line))
+    {
+        if (line.compare(0, key.size(), key) == 0)
+        {
+            stringstream rest(line.substr(key.size()));
+            rest >> value;
+            return true;
+        }
+    }
+    return false;
+}
+
+RunResult runPlanner(const string &planner, const string &problem_file, const vector<string> &args, double timeout)
+{
+    RunResult result;
+    char output_template[] = "/tmp/planner_benchmark_XXXXXX";
+    int output_fd = mkstemp(output_template);
+    if (output_fd < 0)
+        return result;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(output_fd, STDOUT_FILENO);
+        dup2(output_fd, STDERR_FILENO);
+        vector<char *> argv;
+        argv.push_back((char *)planner.c_str());
+        argv.push_back((char *)problem_file.c_str());
+        for (const string &arg : args)
+            argv.push_back((char *)arg.c_str());
+        argv.push_back(nullptr);
+        execv(planner.c_str(), argv.data());
+        _exit(127);
+    }
+    close(output_fd);
+    if (pid < 0)
+    {
+        unlink(output_template);
+        return result;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int status = 0;
+    struct rusage usage;
+    bool timed_out = false;
+    pid_t waited;
+    while ((waited = wait4(pid, &status, WNOHANG, &usage)) == 0)
+    {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (elapsed.count() > timeout)
+        {
+            kill(pid, SIGKILL);
+            waited = wait4(pid, &status, 0, &usage);
+            timed_out = true;
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    // Without a reaped child there is no usage to read; the run stays an "error".
+    if (waited != pid)
+    {
+        unlink(output_template);
+        return result;
+    }
+    result.peak_memory_kb = usage.ru_maxrss;
+
+    ifstream output_file(output_template);
+    stringstream buffer;
+    buffer << output_file.rdbuf();
+    string output = buffer.str();
+    unlink(output_template);
+
+    string value;
+    if (findValue(output, "Grounding Took:", value))
+        result.grounding_time = stod(value);
+    if (findValue(output, "Plan Took:", value))
+        result.plan_time = stod(value);
+    if (findValue(output, "States Expanded", value))
+        result.expanded = stol(value);
+    if (findValue(output, "Plan Length:", value))
+        result.plan_length = stol(value);
+
+    ifstream problem_input(problem_file);
+    stringstream problem;
+    problem << problem_input.rdbuf();
+
+    if (timed_out)
+        result.status = "timeout";
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && result.plan_length >= 0)
+        result.status = validatePlan(problem.str(), output) ? "solved" : "invalid";
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 2)
+        result.status = "unsolvable";
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 3)
+        result.status = "limit";
+    return result;
+}
+
+vector<string> splitArguments(const string &config)
+{
+    vector<string> args;
+    stringstream stream(config);
+    string arg;
+    while (stream >> arg)
+        args.push_back(arg);
+    return args;
+}
+
+int runSuite(const string &planner, int max_size, double timeout, const vector<string> &configs, bool compare_costs)
+{
+    cout << "domain,size,config,status,grounding_s,plan_s,expanded,expansions_per_s,peak_kb,plan_length" << endl;
+    bool failed = false;
+    for (const string domain : {"blocksworld", "fire"})
+    {
+        vector<long> reference_lengths(max_size + 1, -1); // plan lengths of configs[0] by size
+        for (const string &config : configs)
+        {
+            for (int size = (domain == string("blocksworld") ? 3 : 1); size <= max_size; size++)
+            {
+                string problem = domain == string("blocksworld") ? generateBlocksworld(size, size)
+                                                                 : generateFire(size, size + 2, size);
+                char problem_template[] = "/tmp/planner_problem_XXXXXX";
+                int problem_fd = mkstemp(problem_template);
+                if (problem_fd < 0)
+                    return 1;
+                if (write(problem_fd, problem.data(), problem.size()) != (ssize_t)problem.size())
+                    return 1;
+                close(problem_fd);
+
+                RunResult result = runPlanner(planner, problem_template, splitArguments(config), timeout);
+                unlink(problem_template);
+                if (compare_costs && result.status == "solved")
+                {
+                    if (&config == &configs.front())
+                        reference_lengths[size] = result.plan_length;
+                    else if (reference_lengths[size] >= 0 && result.plan_length != reference_lengths[size])
+                        result.status = "cost_mismatch";
+                }
+
+                double search_time = result.plan_time - max(result.grounding_time, 0.0);
+                double expansions_per_second = (result.expanded >= 0 && search_time > 0) ? result.expanded / search_time : -1;
+                cout << domain << "," << size << ",\"" << config << "\"," << result.status << ","
+                     << result.grounding_time << "," << result.plan_time << "," << result.expanded << ","
+                     << expansions_per_second << "," << result.peak_memory_kb << "," << result.plan_length << endl;
+
+                if (result.status == "invalid" || result.status == "cost_mismatch")
+                    failed = true;
+                if (result.status != "solved")
+                    break;
+            }
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    string usage = "usage: benchmark blocksworld <blocks> [seed] | fire <fires> <locations> [seed] | "
+                   "run|compare <planner> [max_size] [timeout] [-c \"<planner args>\"]...";
+    if (argc < 2)
+    {
+        cerr << usage << endl;
+        return 1;
+    }
+    string command = argv[1];
+    if (command == "blocksworld" && argc >= 3)
+    {
+        cout << generateBlocksworld(stoi(argv[2]), argc > 3 ? stoul(argv[3]) : 0);
+        return 0;
+    }
+    if (command == "fire" && argc >= 4)
+    {
+        cout << generateFire(stoi(argv[2]), stoi(argv[3]), argc > 4 ? stoul(argv[4]) : 0);
+        return 0;
+    }
+    if ((command == "run" || command == "compare") && argc >= 3)
+    {
+        string planner = argv[2];
+        int max_size = 8;
+        double timeout = 60;
+        vector<string> configs;
+        vector<string> positional;
+        for (int i = 3; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "-c" && i + 1 < argc)
+                configs.push_back(argv[++i]);
+            else
+                positional.push_back(arg);
+        }
+        if (positional.size() > 0)
+            max_size = stoi(positional[0]);
+        if (positional.size() > 1)
+            timeout = stod(positional[1]);
+        if (configs.empty())
+            configs = {"0", "1", "2"};
+        return runSuite(planner, max_size, timeout, configs, command == "compare");
+    }
+    cerr << usage << endl;
+    return 1;
+}
@@ -1,16 +1,36 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <boost/functional/hash.hpp>
 #include <regex>
 #include <unordered_set>
 #include <set>
+#include <map>
 #include <list>
 #include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
 #include <utility>
 #include <queue>
+#include <deque>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <tuple>
+#include <limits>
+#include <chrono>
+#include <climits>
 #include <time.h>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #define SYMBOLS 0
 #define INITIAL 1
@@ -30,6 +50,260 @@ using namespace std;
 
 bool print_status = true;
 
+struct PlannerOptions
+{
+    string stats_file;                  // --stats=<file>: write a JSON statistics report after planning
+    string search = "astar";            // --search=astar|external|beam|sma|sat|iw|bfws|mrw|portfolio
+    string external_directory = "/tmp"; // --external-dir=<dir>: scratch space for --search=external
+    size_t external_buffer_mb = 64;     // --buffer-mb=<n>: in-memory sort buffer for --search=external
+    size_t beam_width = 100;            // --beam-width=<n>: nodes kept per layer by --search=beam
+    int width = 2;                      // --width=<k>: largest atom-tuple size, 1 or 2, tried by each IW of --search=iw (which falls back to bfws)
+    int walks = 2000;                   // --walks=<n>: random walks per jump of --search=mrw
+    int walk_length = 10;               // --walk-length=<n>: initial length of the random walks
+    int walk_threads = 0;               // --walk-threads=<n>: threads running the walks, 0 for one per core
+    int walk_restarts = 100;            // --walk-restarts=<n>: --search=mrw gives up after this many restarts
+    size_t memory_budget = 1ul << 30;   // --memory-budget=<bytes>[K|M|G]: limit for --search=beam and sma
+    string portfolio = "astar:1,astar:2,beam:1,astar:0"; // --portfolio=<search>:<heuristic>,...: configurations raced by --search=portfolio
+    double time_limit = 0;              // --time-limit=<seconds>: wall-clock limit for planning, 0 for none
+    long expansion_limit = 0;           // --expansion-limit=<n>: expansions per search, 0 for none
+    size_t memory_limit = 0;            // --memory-limit=<bytes>[K|M|G]: resident memory limit, 0 for none
+    double progress_interval = 0;       // --progress=<seconds>: period of the progress line, 0 for none
+    bool parallel_plan = false;         // --parallel-plan: also print the plan deordered into concurrent layers
+    size_t bitstate_bytes = 0;          // --bitstate=<bytes>[K|M|G]: --search=astar keeps visited states in a bit array of this size, 0 for exact
+    int bitstate_hashes = 3;            // --bitstate-hashes=<k>: bits set per state by --bitstate
+    size_t heuristic_cache_bytes = 64ul << 20; // --h-cache=<bytes>[K|M|G]: relaxed distance cache for heuristic 2, 0 to disable
+    bool dead_end_pruning = false;      // --dead-end-pruning: prune relaxed dead ends during search under heuristics 0 and 1 (2 always does)
+    bool serialize_goals = false;       // --serialize-goals: plan for one goal at a time with the configured search
+    double sat_horizon_growth = 1.5;    // --sat-growth=<factor>: horizon increase of --search=sat after an unsatisfiable one
+    int sat_max_horizon = 1000;         // --sat-max-horizon=<steps>: --search=sat gives up beyond this horizon
+    int grounding_threads = 0;          // --ground-threads=<n>: workers that ground the action schemas, 0 for one per core
+    string problems_file;               // --problems=<file>|-: the first argument is a domain; plan for each problem streamed from here
+    string generate_file;               // --generate=<file.cpp>: emit a planner specialized for the grounded task instead of searching (<file>.i.cpp for streamed problem i)
+    string macro_directory;             // --macros=<dir>: learn macro-operators from plans and use them, one file per domain
+};
+
+// "512", "64K", "100M", "2G" -> bytes
+size_t parseByteSize(const string &size)
+{
+    size_t end = 0;
+    double value = stod(size, &end);
+    string unit = size.substr(end);
+    if (unit == "K" || unit == "k")
+        value *= 1024;
+    else if (unit == "M" || unit == "m")
+        value *= 1024 * 1024;
+    else if (unit == "G" || unit == "g")
+        value *= 1024.0 * 1024 * 1024;
+    else if (!unit.empty())
+        throw invalid_argument("Unknown size unit in " + size);
+    return (size_t)value;
+}
+
+PlannerOptions options;
+
+struct MemorySample
+{
+    long expanded;
+    size_t open_list_size;
+    size_t closed_list_size;
+    long resident_kb;
+};
+
+enum SearchStatus
+{
+    SEARCH_RUNNING,
+    SEARCH_SOLVED,
+    SEARCH_UNSOLVABLE,     // a complete search ran out of states
+    SEARCH_FAILED,         // an incomplete search gave up
+    SEARCH_LIMIT_REACHED,
+    SEARCH_CANCELLED,
+    SEARCH_GENERATED       // --generate wrote a specialized planner instead of searching
+};
+
+const char *searchStatusName(SearchStatus status)
+{
+    switch (status)
+    {
+    case SEARCH_SOLVED:
+        return "solved";
+    case SEARCH_UNSOLVABLE:
+        return "unsolvable";
+    case SEARCH_FAILED:
+        return "failed";
+    case SEARCH_LIMIT_REACHED:
+        return "limit reached";
+    case SEARCH_CANCELLED:
+        return "cancelled";
+    case SEARCH_GENERATED:
+        return "generated";
+    default:
+        return "running";
+    }
+}
+
+struct PlannerStatistics
+{
+    SearchStatus status = SEARCH_RUNNING;
+    string limit; // which limit stopped the search, with SEARCH_LIMIT_REACHED
+    double parse_time = 0;
+    double grounding_time = 0;
+    double successor_time = 0;
+    double heuristic_time = 0;
+    double hashing_time = 0;
+    double backtrack_time = 0;
+    double search_time = 0;
+    long grounded_actions = 0;
+    long generated = 0;
+    long expanded = 0;
+    long reopened = 0;
+    long heuristic_cache_hits = 0;
+    long heuristic_cache_misses = 0;
+    long dead_ends = 0; // states pruned as proven dead ends
+    double expected_omissions = 0; // states a bitstate search is expected to have lost
+    long sat_conflicts = 0;        // summed over the horizons of --search=sat
+    long sat_decisions = 0;
+    size_t open_list_peak = 0;
+    double state_bytes = 0; // summed over expanded states, divided out in the report
+    long plan_length = -1;
+    vector<MemorySample> memory_samples;
+};
+
+// Per thread so that portfolio workers count their own search; the main thread's copy is
+// the one reported.
+thread_local PlannerStatistics statistics;
+
+// Set by the first portfolio worker to find a plan; every search loop polls it and gives
+// up without a plan once it is raised.
+atomic<bool> search_cancelled(false);
+
+// Portfolio workers search quietly; only the main thread prints search progress.
+thread_local bool search_output = true;
+
+ostream &searchLog()
+{
+    static ostream null_stream(nullptr);
+    return search_output ? cout : null_stream;
+}
+
+// Start of the current planner() call; --time-limit counts from here.
+chrono::steady_clock::time_point planner_start = chrono::steady_clock::now();
+
+double plannerElapsed()
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - planner_start).count();
+}
+
+bool timeLimitReached()
+{
+    return options.time_limit > 0 && plannerElapsed() >= options.time_limit;
+}
+
+struct SearchProgress
+{
+    double elapsed;
+    long expanded;
+    long generated;
+    double best_f;
+    double best_h;
+    long resident_kb;
+};
+
+void printProgress(const SearchProgress &progress)
+{
+    searchLog() << "Progress: " << progress.elapsed << " s, " << progress.expanded << " expanded, "
+                << progress.generated << " generated, f " << progress.best_f << ", best h " << progress.best_h << ", "
+                << progress.resident_kb << " KB" << endl;
+}
+
+// Called every --progress seconds by a running search.
+function<void(const SearchProgress &)> progress_callback = printProgress;
+
+// Adds the lifetime of the object to `total` (seconds).
+class ScopedTimer
+{
+private:
+    double &total;
+    chrono::steady_clock::time_point start;
+
+public:
+    ScopedTimer(double &total) : total(total), start(chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        total += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+long residentMemoryKB()
+{
+    ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    if (statm >> pages >> resident)
+        return resident * (sysconf(_SC_PAGESIZE) / 1024);
+    return -1;
+}
+
+long peakMemoryKB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Cooperative limits for one search. A search calls stop() once per expansion with the f
+// value it is expanding and its h. Resident memory is read from /proc only every
+// `memory_check_interval` calls; everything else is checked on every call.
+class SearchMonitor
+{
+private:
+    static const long memory_check_interval = 256;
+    long calls = 0;
+    double best_h = numeric_limits<double>::infinity();
+    double next_progress;
+
+    bool limitReached(const string &limit)
+    {
+        statistics.status = SEARCH_LIMIT_REACHED;
+        statistics.limit = limit;
+        searchLog() << "Limit Reached: " << limit << endl;
+        return true;
+    }
+
+public:
+    SearchMonitor() : next_progress(options.progress_interval) {}
+
+    bool stop(double f, double h)
+    {
+        best_h = min(best_h, h);
+        if (search_cancelled)
+        {
+            statistics.status = SEARCH_CANCELLED;
+            return true;
+        }
+        if (options.expansion_limit > 0 && statistics.expanded >= options.expansion_limit)
+            return limitReached("expansions");
+        if (options.time_limit <= 0 && options.progress_interval <= 0 && options.memory_limit == 0)
+            return false;
+        double elapsed = plannerElapsed();
+        if (options.time_limit > 0 && elapsed >= options.time_limit)
+            return limitReached("time");
+        long resident_kb = -1;
+        if (options.memory_limit > 0 && ++calls % memory_check_interval == 0)
+        {
+            resident_kb = residentMemoryKB();
+            if (resident_kb >= 0 && (size_t)resident_kb * 1024 >= options.memory_limit)
+                return limitReached("memory");
+        }
+        if (options.progress_interval > 0 && elapsed >= next_progress)
+        {
+            if (resident_kb < 0)
+                resident_kb = residentMemoryKB();
+            progress_callback(SearchProgress{elapsed, statistics.expanded, statistics.generated, f, best_h, resident_kb});
+            next_progress = elapsed + options.progress_interval;
+        }
+        return false;
+    }
+};
+
 class GroundedCondition
 {
 private:
@@ -504,7 +778,7 @@ struct GroundedActionHasher
 {
     size_t operator()(const GroundedAction &ac) const
     {
-        return hash<string>{}(ac.get_name());
+        return hash<string>{}(ac.toString());
     }
 };
 
@@ -533,10 +807,12 @@ list<string> parse_symbols(string symbols_str)
     return symbols;
 }
 
-Env *create_env(char *filename)
+// Reads `input` into `env` starting in parser state `parser`: SYMBOLS for a problem, ACTIONS
+// for a domain file holding only the action schemas. With `single_problem`, reading stops
+// after the goal conditions so that the next problem of a stream stays unread. Returns
+// whether any line was read.
+bool parseEnvironment(istream &input, Env *env, int parser, bool single_problem)
 {
-    ifstream input_file(filename);
-    Env *env = new Env();
     regex symbolStateRegex("symbols:", regex::icase);
     regex symbolRegex("([a-zA-Z0-9_, ]+) *");
     regex initialConditionRegex("initialconditions:(.*)", regex::icase);
@@ -545,7 +821,7 @@ Env *create_env(char *filename)
     regex actionRegex("actions:", regex::icase);
     regex precondRegex("preconditions:(.*)", regex::icase);
     regex effectRegex("effects:(.*)", regex::icase);
-    int parser = SYMBOLS;
+    bool read = false;
 
     unordered_set<Condition, ConditionHasher, ConditionComparator> preconditions;
     unordered_set<Condition, ConditionHasher, ConditionComparator> effects;
@@ -553,642 +829,4959 @@ Env *create_env(char *filename)
     string action_args;
 
     string line;
-    if (input_file.is_open())
+    while (getline(input, line))
     {
-        while (getline(input_file, line))
-        {
-            string::iterator end_pos = remove(line.begin(), line.end(), ' ');
-            line.erase(end_pos, line.end());
+        string::iterator end_pos = remove(line.begin(), line.end(), ' ');
+        line.erase(end_pos, line.end());
 
-            if (line == "")
-                continue;
+        if (line == "")
+            continue;
+        read = true;
 
-            if (parser == SYMBOLS)
+        if (parser == SYMBOLS)
+        {
+            smatch results;
+            if (regex_search(line, results, symbolStateRegex))
             {
-                smatch results;
-                if (regex_search(line, results, symbolStateRegex))
-                {
-                    line = line.substr(8);
-                    sregex_token_iterator iter(line.begin(), line.end(), symbolRegex, 0);
-                    sregex_token_iterator end;
+                line = line.substr(8);
+                sregex_token_iterator iter(line.begin(), line.end(), symbolRegex, 0);
+                sregex_token_iterator end;
 
-                    env->add_symbols(parse_symbols(iter->str())); // fixed
+                env->add_symbols(parse_symbols(iter->str())); // fixed
 
-                    parser = INITIAL;
-                }
-                else
-                {
-                    cout << "Symbols are not specified correctly." << endl;
-                    throw;
-                }
+                parser = INITIAL;
             }
-            else if (parser == INITIAL)
+            else
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, initialConditionRegex))
-                {
-                    const std::vector<int> submatches = {1, 2};
-                    sregex_token_iterator iter(
-                        line.begin(), line.end(), conditionRegex, submatches);
-                    sregex_token_iterator end;
-
-                    while (iter != end)
-                    {
-                        // name
-                        string predicate = iter->str();
-                        iter++;
-                        // args
-                        string args = iter->str();
-                        iter++;
-
-                        if (predicate[0] == '!')
-                        {
-                            env->remove_initial_condition(
-                                GroundedCondition(predicate.substr(1), parse_symbols(args)));
-                        }
-                        else
-                        {
-                            env->add_initial_condition(
-                                GroundedCondition(predicate, parse_symbols(args)));
-                        }
-                    }
-
-                    parser = GOAL;
-                }
-                else
-                {
-                    cout << "Initial conditions not specified correctly." << endl;
-                    throw;
-                }
+                cout << "Symbols are not specified correctly." << endl;
+                throw;
             }
-            else if (parser == GOAL)
+        }
+        else if (parser == INITIAL)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, initialConditionRegex))
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, goalConditionRegex))
+                const std::vector<int> submatches = {1, 2};
+                sregex_token_iterator iter(
+                    line.begin(), line.end(), conditionRegex, submatches);
+                sregex_token_iterator end;
+
+                while (iter != end)
                 {
-                    const std::vector<int> submatches = {1, 2};
-                    sregex_token_iterator iter(
-                        line.begin(), line.end(), conditionRegex, submatches);
-                    sregex_token_iterator end;
+                    // name
+                    string predicate = iter->str();
+                    iter++;
+                    // args
+                    string args = iter->str();
+                    iter++;
 
-                    while (iter != end)
+                    if (predicate[0] == '!')
                     {
-                        // name
-                        string predicate = iter->str();
-                        iter++;
-                        // args
-                        string args = iter->str();
-                        iter++;
-
-                        if (predicate[0] == '!')
-                        {
-                            env->remove_goal_condition(
-                                GroundedCondition(predicate.substr(1), parse_symbols(args)));
-                        }
-                        else
-                        {
-                            env->add_goal_condition(
-                                GroundedCondition(predicate, parse_symbols(args)));
-                        }
+                        env->remove_initial_condition(
+                            GroundedCondition(predicate.substr(1), parse_symbols(args)));
+                    }
+                    else
+                    {
+                        env->add_initial_condition(
+                            GroundedCondition(predicate, parse_symbols(args)));
                     }
-
-                    parser = ACTIONS;
-                }
-                else
-                {
-                    cout << "Goal conditions not specified correctly." << endl;
-                    throw;
                 }
+
+                parser = GOAL;
             }
-            else if (parser == ACTIONS)
+            else
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, actionRegex))
-                {
-                    parser = ACTION_DEFINITION;
-                }
-                else
-                {
-                    cout << "Actions not specified correctly." << endl;
-                    throw;
-                }
+                cout << "Initial conditions not specified correctly." << endl;
+                throw;
             }
-            else if (parser == ACTION_DEFINITION)
+        }
+        else if (parser == GOAL)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, goalConditionRegex))
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, conditionRegex))
+                const std::vector<int> submatches = {1, 2};
+                sregex_token_iterator iter(
+                    line.begin(), line.end(), conditionRegex, submatches);
+                sregex_token_iterator end;
+
+                while (iter != end)
                 {
-                    const std::vector<int> submatches = {1, 2};
-                    sregex_token_iterator iter(
-                        line.begin(), line.end(), conditionRegex, submatches);
-                    sregex_token_iterator end;
                     // name
-                    action_name = iter->str();
+                    string predicate = iter->str();
                     iter++;
                     // args
-                    action_args = iter->str();
+                    string args = iter->str();
                     iter++;
 
-                    parser = ACTION_PRECONDITION;
-                }
-                else
-                {
-                    cout << "Action not specified correctly." << endl;
-                    throw;
+                    if (predicate[0] == '!')
+                    {
+                        env->remove_goal_condition(
+                            GroundedCondition(predicate.substr(1), parse_symbols(args)));
+                    }
+                    else
+                    {
+                        env->add_goal_condition(
+                            GroundedCondition(predicate, parse_symbols(args)));
+                    }
                 }
+
+                parser = ACTIONS;
+                if (single_problem)
+                    return true;
             }
-            else if (parser == ACTION_PRECONDITION)
+            else
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, precondRegex))
-                {
-                    const std::vector<int> submatches = {1, 2};
-                    sregex_token_iterator iter(
-                        line.begin(), line.end(), conditionRegex, submatches);
-                    sregex_token_iterator end;
+                cout << "Goal conditions not specified correctly." << endl;
+                throw;
+            }
+        }
+        else if (parser == ACTIONS)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, actionRegex))
+            {
+                parser = ACTION_DEFINITION;
+            }
+            else
+            {
+                cout << "Actions not specified correctly." << endl;
+                throw;
+            }
+        }
+        else if (parser == ACTION_DEFINITION)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, conditionRegex))
+            {
+                const std::vector<int> submatches = {1, 2};
+                sregex_token_iterator iter(
+                    line.begin(), line.end(), conditionRegex, submatches);
+                sregex_token_iterator end;
+                // name
+                action_name = iter->str();
+                iter++;
+                // args
+                action_args = iter->str();
+                iter++;
 
-                    while (iter != end)
-                    {
-                        // name
-                        string predicate = iter->str();
-                        iter++;
-                        // args
-                        string args = iter->str();
-                        iter++;
+                parser = ACTION_PRECONDITION;
+            }
+            else
+            {
+                cout << "Action not specified correctly." << endl;
+                throw;
+            }
+        }
+        else if (parser == ACTION_PRECONDITION)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, precondRegex))
+            {
+                const std::vector<int> submatches = {1, 2};
+                sregex_token_iterator iter(
+                    line.begin(), line.end(), conditionRegex, submatches);
+                sregex_token_iterator end;
 
-                        bool truth;
+                while (iter != end)
+                {
+                    // name
+                    string predicate = iter->str();
+                    iter++;
+                    // args
+                    string args = iter->str();
+                    iter++;
 
-                        if (predicate[0] == '!')
-                        {
-                            predicate = predicate.substr(1);
-                            truth = false;
-                        }
-                        else
-                        {
-                            truth = true;
-                        }
+                    bool truth;
 
-                        Condition precond(predicate, parse_symbols(args), truth);
-                        preconditions.insert(precond);
+                    if (predicate[0] == '!')
+                    {
+                        predicate = predicate.substr(1);
+                        truth = false;
+                    }
+                    else
+                    {
+                        truth = true;
                     }
 
-                    parser = ACTION_EFFECT;
-                }
-                else
-                {
-                    cout << "Precondition not specified correctly." << endl;
-                    throw;
+                    Condition precond(predicate, parse_symbols(args), truth);
+                    preconditions.insert(precond);
                 }
+
+                parser = ACTION_EFFECT;
             }
-            else if (parser == ACTION_EFFECT)
+            else
             {
-                const char *line_c = line.c_str();
-                if (regex_match(line_c, effectRegex))
-                {
-                    const std::vector<int> submatches = {1, 2};
-                    sregex_token_iterator iter(
-                        line.begin(), line.end(), conditionRegex, submatches);
-                    sregex_token_iterator end;
-
-                    while (iter != end)
-                    {
-                        // name
-                        string predicate = iter->str();
-                        iter++;
-                        // args
-                        string args = iter->str();
-                        iter++;
+                cout << "Precondition not specified correctly." << endl;
+                throw;
+            }
+        }
+        else if (parser == ACTION_EFFECT)
+        {
+            const char *line_c = line.c_str();
+            if (regex_match(line_c, effectRegex))
+            {
+                const std::vector<int> submatches = {1, 2};
+                sregex_token_iterator iter(
+                    line.begin(), line.end(), conditionRegex, submatches);
+                sregex_token_iterator end;
 
-                        bool truth;
+                while (iter != end)
+                {
+                    // name
+                    string predicate = iter->str();
+                    iter++;
+                    // args
+                    string args = iter->str();
+                    iter++;
 
-                        if (predicate[0] == '!')
-                        {
-                            predicate = predicate.substr(1);
-                            truth = false;
-                        }
-                        else
-                        {
-                            truth = true;
-                        }
+                    bool truth;
 
-                        Condition effect(predicate, parse_symbols(args), truth);
-                        effects.insert(effect);
+                    if (predicate[0] == '!')
+                    {
+                        predicate = predicate.substr(1);
+                        truth = false;
+                    }
+                    else
+                    {
+                        truth = true;
                     }
 
-                    env->add_action(
-                        Action(action_name, parse_symbols(action_args), preconditions, effects));
-
-                    preconditions.clear();
-                    effects.clear();
-                    parser = ACTION_DEFINITION;
-                }
-                else
-                {
-                    cout << "Effects not specified correctly." << endl;
-                    throw;
+                    Condition effect(predicate, parse_symbols(args), truth);
+                    effects.insert(effect);
                 }
+
+                env->add_action(
+                    Action(action_name, parse_symbols(action_args), preconditions, effects));
+
+                preconditions.clear();
+                effects.clear();
+                parser = ACTION_DEFINITION;
+            }
+            else
+            {
+                cout << "Effects not specified correctly." << endl;
+                throw;
             }
         }
-        input_file.close();
     }
+    return read;
+}
 
+Env *create_env(char *filename)
+{
+    ifstream input_file(filename);
+    Env *env = new Env();
+    if (input_file.is_open())
+        parseEnvironment(input_file, env, SYMBOLS, false);
     else
         cout << "Unable to open file";
-
     return env;
 }
 
-vector<string> get_arguements(condition_set &conditions)
+// A macro-operator: a sequence of primitive actions whose arguments are macro parameters
+// or domain constants.
+struct Macro
 {
-    unordered_set<string> args;
-    for (const GroundedCondition &c : conditions)
+    list<string> parameters;
+    vector<pair<string, list<string>>> steps;
+    long count = 0; // occurrences in the plans learned from so far
+
+    string signature() const
     {
-        for (const string str : c.get_arg_values())
+        string signature;
+        for (const pair<string, list<string>> &step : this->steps)
         {
-            args.insert(str);
+            signature += (signature.empty() ? "" : ",") + step.first + "(";
+            string separator;
+            for (const string &arg : step.second)
+            {
+                signature += separator + arg;
+                separator = ";";
+            }
+            signature += ")";
         }
+        return signature;
     }
-    vector<string> args_vec;
-    args_vec.insert(args_vec.end(), args.begin(), args.end());
-    return args_vec;
-}
+};
 
-vector<pair<string, int>> getActionNames(unordered_set<Action, ActionHasher, ActionComparator> action_set)
+// Grounds `act` with `values` for its parameters; arguments that are not parameters are
+// constants.
+GroundedAction groundAction(const Action &act, const list<string> &values)
 {
-    vector<pair<string, int>> actions;
-    for (const Action &act : action_set)
+    unordered_map<string, string> binding;
+    auto value = values.begin();
+    for (const string &parameter : act.get_args())
+        binding[parameter] = *value++;
+    auto ground = [&](const Condition &cond)
     {
-        actions.push_back(make_pair(act.get_name(), act.get_args().size()));
-    }
-    return actions;
+        list<string> args;
+        for (const string &arg : cond.get_args())
+            args.push_back(binding.count(arg) ? binding[arg] : arg);
+        return GroundedCondition(cond.get_predicate(), args, cond.get_truth());
+    };
+    condition_set preconditions;
+    condition_set effects;
+    for (const Condition &pre : act.get_preconditions())
+        preconditions.insert(ground(pre));
+    for (const Condition &effect : act.get_effects())
+        effects.insert(ground(effect));
+    return GroundedAction(act.get_name(), values, preconditions, effects);
 }
 
-void swap(vector<string> &arguments, int i, int j)
-{
-    string temp = arguments[i];
-    arguments[i] = arguments[j];
-    arguments[j] = temp;
-}
-void enumerate(vector<string> &arguments, int n, int k, vector<list<string>> &permutations)
+// Macro-operators mined from solved plans, persisted per domain. Windows of up to
+// `max_length` causally linked plan steps are lifted into step sequences and counted
+// across runs; the `max_macros` most frequent ones seen at least `min_count` times are
+// compiled into Action schemas for grounding.
+class MacroLibrary
 {
-    if (k == 0)
+private:
+    static const int max_length = 3;
+    static const int min_count = 2;
+    static const size_t max_macros = 8;
+    map<string, Macro> candidates; // by signature
+    unordered_map<string, Macro> compiled; // by compiled action name
+
+    static string parameterName(int i)
     {
-        list<string> singlePermutation;
-        for (int i = n; i < arguments.size(); i++)
+        return "_v" + to_string(i);
+    }
+
+    // Composes the steps of `macro` into one schema: a precondition is needed unless an
+    // earlier step already made it true, and later effects override earlier ones; within a
+    // step adds override deletes, as in applyAction. Fails if a step needs something an
+    // earlier step made false.
+    static bool compose(Env *env, const string &name, const Macro &macro, Action &result)
+    {
+        map<string, Condition> preconditions;
+        map<string, Condition> effects;
+        for (const pair<string, list<string>> &step : macro.steps)
         {
-            singlePermutation.push_back(arguments[i]);
+            Action act = env->get_action(step.first);
+            unordered_map<string, string> binding;
+            auto arg = step.second.begin();
+            for (const string &parameter : act.get_args())
+                binding[parameter] = *arg++;
+            auto substitute = [&](const Condition &cond)
+            {
+                list<string> args;
+                for (const string &a : cond.get_args())
+                    args.push_back(binding.count(a) ? binding[a] : a);
+                return Condition(cond.get_predicate(), args, cond.get_truth());
+            };
+            for (const Condition &pre : act.get_preconditions())
+            {
+                Condition lifted = substitute(pre);
+                string key = Condition(lifted.get_predicate(), lifted.get_args(), true).toString();
+                auto effect = effects.find(key);
+                if (effect != effects.end())
+                {
+                    if (effect->second.get_truth() != lifted.get_truth())
+                        return false;
+                    continue;
+                }
+                auto earlier = preconditions.find(key);
+                if (earlier != preconditions.end() && earlier->second.get_truth() != lifted.get_truth())
+                    return false;
+                preconditions.emplace(key, lifted);
+            }
+            for (bool truth : {false, true})
+            {
+                for (const Condition &effect : act.get_effects())
+                {
+                    if (effect.get_truth() != truth)
+                        continue;
+                    Condition lifted = substitute(effect);
+                    string key = Condition(lifted.get_predicate(), lifted.get_args(), true).toString();
+                    effects.erase(key);
+                    effects.emplace(key, lifted);
+                }
+            }
         }
-        permutations.push_back(singlePermutation);
-        return;
+        unordered_set<Condition, ConditionHasher, ConditionComparator> precondition_set;
+        unordered_set<Condition, ConditionHasher, ConditionComparator> effect_set;
+        for (const pair<const string, Condition> &pre : preconditions)
+            precondition_set.insert(pre.second);
+        for (const pair<const string, Condition> &effect : effects)
+            effect_set.insert(effect.second);
+        result = Action(name, macro.parameters, precondition_set, effect_set);
+        return true;
     }
-    for (int i = 0; i < n; i++)
+
+    // Lifts plan steps [begin, end) into a macro. Objects bound to action parameters become
+    // macro parameters in order of appearance; fails if one of them is also a constant of
+    // the steps, since grounding could not keep the two apart.
+    static bool lift(Env *env, const vector<GroundedAction> &plan, int begin, int end, Macro &macro)
     {
-        swap(arguments, i, n - 1);
-        enumerate(arguments, n - 1, k - 1, permutations);
-        swap(arguments, i, n - 1);
-    }
+        unordered_map<string, string> parameters;
+        unordered_set<string> constants;
+        for (int i = begin; i < end; i++)
+        {
+            Action act = env->get_action(plan[i].get_name());
+            list<string> schema_parameters = act.get_args();
+            for (const Condition &cond : act.get_preconditions())
+                for (const string &arg : cond.get_args())
+                    if (find(schema_parameters.begin(), schema_parameters.end(), arg) == schema_parameters.end())
+                        constants.insert(arg);
+            for (const Condition &cond : act.get_effects())
+                for (const string &arg : cond.get_args())
+                    if (find(schema_parameters.begin(), schema_parameters.end(), arg) == schema_parameters.end())
+                        constants.insert(arg);
+            list<string> args;
+            for (const string &object : plan[i].get_arg_values())
+            {
+                if (parameters.find(object) == parameters.end())
+                {
+                    string parameter = parameterName(parameters.size());
+                    parameters[object] = parameter;
+                    macro.parameters.push_back(parameter);
+                }
+                args.push_back(parameters[object]);
+            }
+            macro.steps.push_back(make_pair(plan[i].get_name(), args));
+        }
+        for (const pair<const string, string> &parameter : parameters)
+            if (constants.count(parameter.first))
+                return false;
+        Action composed("", {}, {}, {});
+        return compose(env, "", macro, composed);
+    }
+
+    // Consecutive steps are linked when the second needs an atom the first adds.
+    static bool linked(const GroundedAction &first, const GroundedAction &second)
+    {
+        condition_set added;
+        for (const GroundedCondition &effect : first.get_effects())
+            if (effect.get_truth())
+                added.insert(effect);
+        for (const GroundedCondition &pre : second.get_preconditions())
+            if (pre.get_truth() && added.count(pre))
+                return true;
+        return false;
+    }
+
+public:
+    // Key for the domain's macro file: a 64-bit FNV-1a hash of its canonical action schemas,
+    // which unlike std::hash is the same for every build.
+    static string domainKey(Env *env)
+    {
+        vector<string> schemas;
+        for (const Action &act : env->get_all_actions())
+        {
+            vector<string> conditions;
+            for (const Condition &pre : act.get_preconditions())
+                conditions.push_back("pre " + pre.toString());
+            for (const Condition &effect : act.get_effects())
+                conditions.push_back("eff " + effect.toString());
+            sort(conditions.begin(), conditions.end());
+            string schema = act.toString();
+            for (const string &cond : conditions)
+                schema += " " + cond;
+            schemas.push_back(schema);
+        }
+        sort(schemas.begin(), schemas.end());
+        string domain;
+        for (const string &schema : schemas)
+            domain += schema + "\n";
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : domain)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        stringstream key;
+        key << hex << hash;
+        return key.str();
+    }
+
+    // File format: one macro per line, "<count> <step>(<args>),<step>(<args>),...", with
+    // arguments separated by ';'.
+    void load(const string &filename)
+    {
+        ifstream in(filename);
+        string line;
+        while (getline(in, line))
+        {
+            stringstream fields(line);
+            Macro macro;
+            string signature;
+            if (!(fields >> macro.count >> signature))
+                continue;
+            stringstream steps(signature);
+            string step;
+            unordered_set<string> seen;
+            while (getline(steps, step, ')'))
+            {
+                if (!step.empty() && step[0] == ',')
+                    step = step.substr(1);
+                size_t open = step.find('(');
+                if (open == string::npos)
+                    break;
+                list<string> args;
+                stringstream arg_stream(step.substr(open + 1));
+                string arg;
+                while (getline(arg_stream, arg, ';'))
+                {
+                    args.push_back(arg);
+                    if (arg.rfind("_v", 0) == 0 && seen.insert(arg).second)
+                        macro.parameters.push_back(arg);
+                }
+                macro.steps.push_back(make_pair(step.substr(0, open), args));
+            }
+            this->candidates[macro.signature()] = macro;
+        }
+    }
+
+    void save(const string &filename) const
+    {
+        ofstream out(filename);
+        if (!out.is_open())
+        {
+            cout << "Unable to write macros to " << filename << endl;
+            return;
+        }
+        for (const pair<const string, Macro> &candidate : this->candidates)
+            out << candidate.second.count << " " << candidate.first << endl;
+    }
+
+    // Action schemas for the most frequent macros; their names map back to the macros.
+    vector<Action> compile(Env *env)
+    {
+        vector<const Macro *> frequent;
+        for (const pair<const string, Macro> &candidate : this->candidates)
+            if (candidate.second.count >= min_count)
+                frequent.push_back(&candidate.second);
+        stable_sort(frequent.begin(), frequent.end(), [](const Macro *a, const Macro *b)
+                    { return a->count > b->count; });
+        vector<Action> actions;
+        this->compiled.clear();
+        for (const Macro *macro : frequent)
+        {
+            if (actions.size() >= max_macros)
+                break;
+            string name = "Macro";
+            for (const pair<string, list<string>> &step : macro->steps)
+                name += "_" + step.first;
+            name += "_" + to_string(actions.size());
+            Action act("", {}, {}, {});
+            if (!compose(env, name, *macro, act))
+                continue;
+            actions.push_back(act);
+            this->compiled[name] = *macro;
+        }
+        return actions;
+    }
+
+    bool isMacro(const string &name) const
+    {
+        return this->compiled.find(name) != this->compiled.end();
+    }
+
+    list<GroundedAction> expand(Env *env, const list<GroundedAction> &plan) const
+    {
+        list<GroundedAction> primitive;
+        for (const GroundedAction &action : plan)
+        {
+            auto macro = this->compiled.find(action.get_name());
+            if (macro == this->compiled.end())
+            {
+                primitive.push_back(action);
+                continue;
+            }
+            unordered_map<string, string> binding;
+            list<string> values = action.get_arg_values();
+            auto value = values.begin();
+            for (const string &parameter : macro->second.parameters)
+                binding[parameter] = *value++;
+            for (const pair<string, list<string>> &step : macro->second.steps)
+            {
+                list<string> step_values;
+                for (const string &arg : step.second)
+                    step_values.push_back(binding.count(arg) ? binding[arg] : arg);
+                primitive.push_back(groundAction(env->get_action(step.first), step_values));
+            }
+        }
+        return primitive;
+    }
+
+    // Counts the liftable windows of a primitive plan.
+    void learn(Env *env, const list<GroundedAction> &plan)
+    {
+        vector<GroundedAction> steps(plan.begin(), plan.end());
+        for (int begin = 0; begin < (int)steps.size(); begin++)
+        {
+            for (int end = begin + 2; end <= begin + max_length && end <= (int)steps.size(); end++)
+            {
+                if (!linked(steps[end - 2], steps[end - 1]))
+                    break;
+                Macro macro;
+                if (!lift(env, steps, begin, end, macro))
+                    continue;
+                Macro &candidate = this->candidates.emplace(macro.signature(), macro).first->second;
+                candidate.count++;
+            }
+        }
+    }
+};
+
+MacroLibrary macro_library;
+
+vector<string> get_arguements(condition_set &conditions)
+{
+    unordered_set<string> args;
+    for (const GroundedCondition &c : conditions)
+    {
+        for (const string str : c.get_arg_values())
+        {
+            args.insert(str);
+        }
+    }
+    vector<string> args_vec;
+    args_vec.insert(args_vec.end(), args.begin(), args.end());
+    return args_vec;
+}
+
+vector<pair<string, int>> getActionNames(unordered_set<Action, ActionHasher, ActionComparator> action_set)
+{
+    vector<pair<string, int>> actions;
+    for (const Action &act : action_set)
+    {
+        actions.push_back(make_pair(act.get_name(), act.get_args().size()));
+    }
+    return actions;
+}
+
+void swap(vector<string> &arguments, int i, int j)
+{
+    string temp = arguments[i];
+    arguments[i] = arguments[j];
+    arguments[j] = temp;
+}
+void enumerate(vector<string> &arguments, int n, int k, vector<list<string>> &permutations)
+{
+    if (k == 0)
+    {
+        list<string> singlePermutation;
+        for (int i = n; i < arguments.size(); i++)
+        {
+            singlePermutation.push_back(arguments[i]);
+        }
+        permutations.push_back(singlePermutation);
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        swap(arguments, i, n - 1);
+        enumerate(arguments, n - 1, k - 1, permutations);
+        swap(arguments, i, n - 1);
+    }
+}
+
+vector<list<string>> getPermuations(vector<string> arguments, int num_arguments)
+{
+    vector<list<string>> permutations;
+    enumerate(arguments, arguments.size(), num_arguments, permutations);
+    return permutations;
+}
+
+// A state is a bit vector over the atoms of the grounded task.
+typedef vector<uint64_t> State;
+
+inline bool holds(const State &state, int atom)
+{
+    return (state[atom >> 6] >> (atom & 63)) & 1;
+}
+
+inline void addAtom(State &state, int atom)
+{
+    state[atom >> 6] |= uint64_t(1) << (atom & 63);
+}
+
+inline void deleteAtom(State &state, int atom)
+{
+    state[atom >> 6] &= ~(uint64_t(1) << (atom & 63));
+}
+
+struct StateHasher
+{
+    size_t operator()(const State &state) const
+    {
+        return boost::hash_range(state.begin(), state.end());
+    }
+};
+
+typedef unordered_set<State, StateHasher> state_set;
+
+// Dense IDs for the grounded atoms that can matter during search.
+struct AtomTable
+{
+    vector<GroundedCondition> atoms;
+    unordered_map<string, int> ids;
+
+    int size() const
+    {
+        return this->atoms.size();
+    }
+
+    int find(const string &key) const
+    {
+        auto it = this->ids.find(key);
+        return it == this->ids.end() ? -1 : it->second;
+    }
+
+    int insert(const GroundedCondition &atom)
+    {
+        auto inserted = this->ids.emplace(atom.toString(), this->atoms.size());
+        if (inserted.second)
+            this->atoms.push_back(atom);
+        return inserted.first->second;
+    }
+};
+
+// Struct-of-arrays table of grounded operators. The preconditions of operator i are
+// precondition_atoms[precondition_begin[i] .. precondition_begin[i + 1]), and likewise for
+// negative preconditions, add effects and delete effects. Static preconditions are checked
+// once during grounding and do not appear in the table.
+struct OperatorTable
+{
+    vector<string> names;
+    vector<list<string>> arguments;
+    vector<int> precondition_begin = {0};
+    vector<int> negative_begin = {0};
+    vector<int> add_begin = {0};
+    vector<int> delete_begin = {0};
+    vector<int> precondition_atoms;
+    vector<int> negative_atoms;
+    vector<int> add_atoms;
+    vector<int> delete_atoms;
+
+    int size() const
+    {
+        return this->names.size();
+    }
+};
+
+// Compact storage form of a State under a StateEncoding; short enough in practice to stay
+// inside std::string's inline buffer.
+typedef string PackedState;
+
+// Finite-domain (SAS+) encoding of states: variable v is stored in bit_width[v] bits at
+// bit_offset[v] and holds the index of its true atom, or variable_atoms[v].size() if none.
+struct StateEncoding
+{
+    vector<vector<int>> variable_atoms;
+    vector<int> bit_offset;
+    vector<int> bit_width;
+    int packed_bytes = 0;
+};
+
+// Bit-matrix form of the operator preconditions for batched applicability tests. Row r of
+// required_by has bit op set when operator op requires positive_atoms[r], and forbidden_by
+// does the same for negative preconditions. An operator is applicable unless a row that
+// blocks it in the current state (a false required atom or a true forbidden atom) has its
+// bit set, so one pass ORs the blocking rows together, 256 operators per AVX2 instruction.
+struct ApplicabilityMatrix
+{
+    int operator_words = 0; // per row, padded to a multiple of 4 for 256-bit loads
+    vector<int> positive_atoms;
+    vector<int> negative_atoms;
+    vector<uint64_t> required_by;
+    vector<uint64_t> forbidden_by;
+};
+
+struct Task
+{
+    AtomTable atoms;
+    OperatorTable operators;
+    State initial_state;
+    vector<int> goal_atoms;
+    vector<char> is_goal; // indexed by atom ID
+    int state_words = 0;
+    vector<vector<int>> mutex_groups;
+    StateEncoding encoding;
+    ApplicabilityMatrix applicability;
+    // Operators by precondition atom: precondition_of[precondition_of_begin[a] .. [a + 1]).
+    vector<int> precondition_of_begin;
+    vector<int> precondition_of;
+    vector<int> unconditional_operators; // without positive preconditions
+};
+
+State emptyState(const Task &task)
+{
+    return State(task.state_words, 0);
+}
+
+PackedState packState(const Task &task, const State &state)
+{
+    const StateEncoding &encoding = task.encoding;
+    PackedState packed(encoding.packed_bytes, '\0');
+    for (size_t var = 0; var < encoding.variable_atoms.size(); var++)
+    {
+        const vector<int> &atoms = encoding.variable_atoms[var];
+        unsigned value = atoms.size();
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            if (holds(state, atoms[i]))
+            {
+                value = i;
+                break;
+            }
+        }
+        for (int bit = 0; bit < encoding.bit_width[var]; bit++)
+        {
+            if ((value >> bit) & 1)
+            {
+                int position = encoding.bit_offset[var] + bit;
+                packed[position >> 3] |= (char)(1 << (position & 7));
+            }
+        }
+    }
+    return packed;
+}
+
+State unpackState(const Task &task, const PackedState &packed)
+{
+    const StateEncoding &encoding = task.encoding;
+    State state = emptyState(task);
+    for (size_t var = 0; var < encoding.variable_atoms.size(); var++)
+    {
+        unsigned value = 0;
+        for (int bit = 0; bit < encoding.bit_width[var]; bit++)
+        {
+            int position = encoding.bit_offset[var] + bit;
+            if ((packed[position >> 3] >> (position & 7)) & 1)
+                value |= 1u << bit;
+        }
+        if (value < encoding.variable_atoms[var].size())
+            addAtom(state, encoding.variable_atoms[var][value]);
+    }
+    return state;
+}
+
+bool checkPreconditions(const Task &task, const State &state, int op)
+{
+    const OperatorTable &ops = task.operators;
+    for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+    {
+        if (!holds(state, ops.precondition_atoms[i]))
+            return false;
+    }
+    for (int i = ops.negative_begin[op]; i < ops.negative_begin[op + 1]; i++)
+    {
+        if (holds(state, ops.negative_atoms[i]))
+            return false;
+    }
+    return true;
+}
+
+// ORs into `blocked` every row of the matrix whose atom blocks its operators in `state`:
+// required atoms that are false and forbidden atoms that are true.
+void blockedOperatorsScalar(const ApplicabilityMatrix &matrix, const State &state, uint64_t *blocked)
+{
+    int words = matrix.operator_words;
+    for (size_t row = 0; row < matrix.positive_atoms.size(); row++)
+    {
+        if (holds(state, matrix.positive_atoms[row]))
+            continue;
+        const uint64_t *mask = &matrix.required_by[row * words];
+        for (int w = 0; w < words; w++)
+            blocked[w] |= mask[w];
+    }
+    for (size_t row = 0; row < matrix.negative_atoms.size(); row++)
+    {
+        if (!holds(state, matrix.negative_atoms[row]))
+            continue;
+        const uint64_t *mask = &matrix.forbidden_by[row * words];
+        for (int w = 0; w < words; w++)
+            blocked[w] |= mask[w];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) void blockedOperatorsAVX2(const ApplicabilityMatrix &matrix, const State &state, uint64_t *blocked)
+{
+    int words = matrix.operator_words;
+    for (int w = 0; w < words; w += 4)
+    {
+        __m256i accumulator = _mm256_loadu_si256((const __m256i *)&blocked[w]);
+        for (size_t row = 0; row < matrix.positive_atoms.size(); row++)
+        {
+            if (!holds(state, matrix.positive_atoms[row]))
+                accumulator = _mm256_or_si256(accumulator, _mm256_loadu_si256((const __m256i *)&matrix.required_by[row * words + w]));
+        }
+        for (size_t row = 0; row < matrix.negative_atoms.size(); row++)
+        {
+            if (holds(state, matrix.negative_atoms[row]))
+                accumulator = _mm256_or_si256(accumulator, _mm256_loadu_si256((const __m256i *)&matrix.forbidden_by[row * words + w]));
+        }
+        _mm256_storeu_si256((__m256i *)&blocked[w], accumulator);
+    }
+}
+#endif
+
+typedef void (*BlockedOperatorsKernel)(const ApplicabilityMatrix &, const State &, uint64_t *);
+
+BlockedOperatorsKernel selectBlockedOperatorsKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+        return blockedOperatorsAVX2;
+#endif
+    return blockedOperatorsScalar;
+}
+
+// IDs of all operators applicable in `state`, in increasing order, from one pass over the
+// precondition bit-matrix.
+void applicableOperators(const Task &task, const State &state, vector<int> &applicable)
+{
+    static const BlockedOperatorsKernel kernel = selectBlockedOperatorsKernel();
+    const ApplicabilityMatrix &matrix = task.applicability;
+    // Reused across calls; only its size changes, with the task.
+    thread_local vector<uint64_t> blocked;
+    blocked.assign(matrix.operator_words, 0);
+    kernel(matrix, state, blocked.data());
+    applicable.clear();
+    int num_operators = task.operators.size();
+    for (int w = 0; w < matrix.operator_words && w * 64 < num_operators; w++)
+    {
+        uint64_t free = ~blocked[w];
+        if (num_operators - w * 64 < 64)
+            free &= (uint64_t(1) << (num_operators - w * 64)) - 1;
+        while (free)
+        {
+            applicable.push_back(w * 64 + __builtin_ctzll(free));
+            free &= free - 1;
+        }
+    }
+}
+
+ApplicabilityMatrix buildApplicabilityMatrix(const Task &task)
+{
+    const OperatorTable &ops = task.operators;
+    ApplicabilityMatrix matrix;
+    matrix.operator_words = ((ops.size() + 255) / 256) * 4;
+    vector<int> positive_row(task.atoms.size(), -1);
+    vector<int> negative_row(task.atoms.size(), -1);
+    for (int op = 0; op < ops.size(); op++)
+    {
+        for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+        {
+            int atom = ops.precondition_atoms[i];
+            if (positive_row[atom] < 0)
+            {
+                positive_row[atom] = matrix.positive_atoms.size();
+                matrix.positive_atoms.push_back(atom);
+                matrix.required_by.resize(matrix.required_by.size() + matrix.operator_words, 0);
+            }
+            matrix.required_by[positive_row[atom] * matrix.operator_words + op / 64] |= uint64_t(1) << (op % 64);
+        }
+        for (int i = ops.negative_begin[op]; i < ops.negative_begin[op + 1]; i++)
+        {
+            int atom = ops.negative_atoms[i];
+            if (negative_row[atom] < 0)
+            {
+                negative_row[atom] = matrix.negative_atoms.size();
+                matrix.negative_atoms.push_back(atom);
+                matrix.forbidden_by.resize(matrix.forbidden_by.size() + matrix.operator_words, 0);
+            }
+            matrix.forbidden_by[negative_row[atom] * matrix.operator_words + op / 64] |= uint64_t(1) << (op % 64);
+        }
+    }
+    return matrix;
+}
+
+State applyAction(const Task &task, const State &state, int op)
+{
+    const OperatorTable &ops = task.operators;
+    State new_state = state;
+    for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+        deleteAtom(new_state, ops.delete_atoms[i]);
+    for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+        addAtom(new_state, ops.add_atoms[i]);
+    return new_state;
+}
+
+State applyActionHeuristic(const Task &task, const State &state, int op)
+{
+    const OperatorTable &ops = task.operators;
+    State new_state = state;
+    for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+        addAtom(new_state, ops.add_atoms[i]);
+    return new_state;
+}
+
+GroundedAction getGroundedAction(const Task &task, int op)
+{
+    const OperatorTable &ops = task.operators;
+    condition_set preconditions;
+    condition_set effects;
+    for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+        preconditions.insert(task.atoms.atoms[ops.precondition_atoms[i]]);
+    for (int i = ops.negative_begin[op]; i < ops.negative_begin[op + 1]; i++)
+    {
+        const GroundedCondition &atom = task.atoms.atoms[ops.negative_atoms[i]];
+        preconditions.insert(GroundedCondition(atom.get_predicate(), atom.get_arg_values(), false));
+    }
+    for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+        effects.insert(task.atoms.atoms[ops.add_atoms[i]]);
+    for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+    {
+        const GroundedCondition &atom = task.atoms.atoms[ops.delete_atoms[i]];
+        effects.insert(GroundedCondition(atom.get_predicate(), atom.get_arg_values(), false));
+    }
+    return GroundedAction(ops.names[op], ops.arguments[op], preconditions, effects);
+}
+
+// A schema condition with each argument resolved to a schema parameter index, or -1 when
+// the argument is a constant symbol such as Table.
+struct LiftedCondition
+{
+    string predicate;
+    vector<int> parameters;
+    vector<string> constants;
+    bool truth;
+    bool is_static;
+};
+
+LiftedCondition liftCondition(const Condition &cond, const vector<string> &parameters, const unordered_set<string> &fluent_predicates)
+{
+    LiftedCondition lifted;
+    lifted.predicate = cond.get_predicate();
+    lifted.truth = cond.get_truth();
+    lifted.is_static = fluent_predicates.find(lifted.predicate) == fluent_predicates.end();
+    for (const string &arg : cond.get_args())
+    {
+        auto parameter = find(parameters.begin(), parameters.end(), arg);
+        lifted.parameters.push_back(parameter == parameters.end() ? -1 : parameter - parameters.begin());
+        lifted.constants.push_back(arg);
+    }
+    return lifted;
+}
+
+GroundedCondition groundCondition(const LiftedCondition &lifted, const vector<string> &values)
+{
+    list<string> args;
+    for (size_t i = 0; i < lifted.parameters.size(); i++)
+        args.push_back(lifted.parameters[i] < 0 ? lifted.constants[i] : values[lifted.parameters[i]]);
+    return GroundedCondition(lifted.predicate, args);
+}
+
+// Appends `atom` to the range of `atoms` starting at `begin` unless it is already there;
+// a constant argument can make two schema conditions ground to the same atom.
+void pushUnique(vector<int> &atoms, int begin, int atom)
+{
+    if (find(atoms.begin() + begin, atoms.end(), atom) == atoms.end())
+        atoms.push_back(atom);
+}
+
+// One action schema prepared for grounding: its conditions lifted to parameter indices and
+// the argument tuples it is instantiated with.
+struct GroundingSchema
+{
+    string name;
+    vector<LiftedCondition> preconditions;
+    vector<LiftedCondition> effects;
+    unordered_set<string> macro_constants;
+    const vector<list<string>> *arguments;
+};
+
+// A range of one schema's argument tuples, grounded by a single worker into its own atom
+// and operator tables. Local atom ids are assigned in order of first use, the order in
+// which a serial pass would have added them to the task.
+struct GroundingChunk
+{
+    const GroundingSchema *schema;
+    size_t begin;
+    size_t end;
+    AtomTable atoms;
+    OperatorTable operators;
+};
+
+// Grounds the chunk's argument tuples into `atoms` and `ops`. Operators whose static
+// preconditions (predicates no schema changes) fail in the initial state can never be
+// applied and are dropped.
+void groundChunk(const GroundingChunk &chunk, const condition_set &initial, AtomTable &atoms, OperatorTable &ops)
+{
+    const GroundingSchema &schema = *chunk.schema;
+    for (size_t a = chunk.begin; a < chunk.end; a++)
+    {
+        const list<string> &arg = (*schema.arguments)[a];
+        vector<string> values(arg.begin(), arg.end());
+        bool applicable = true;
+        for (const string &value : values)
+            applicable = applicable && schema.macro_constants.find(value) == schema.macro_constants.end();
+        for (const LiftedCondition &pre : schema.preconditions)
+        {
+            if (pre.is_static && (initial.find(groundCondition(pre, values)) != initial.end()) != pre.truth)
+            {
+                applicable = false;
+                break;
+            }
+        }
+        if (!applicable)
+            continue;
+
+        for (const LiftedCondition &pre : schema.preconditions)
+        {
+            if (pre.is_static)
+                continue;
+            if (pre.truth)
+                pushUnique(ops.precondition_atoms, ops.precondition_begin.back(), atoms.insert(groundCondition(pre, values)));
+            else
+                pushUnique(ops.negative_atoms, ops.negative_begin.back(), atoms.insert(groundCondition(pre, values)));
+        }
+        for (const LiftedCondition &effect : schema.effects)
+        {
+            if (effect.truth)
+                pushUnique(ops.add_atoms, ops.add_begin.back(), atoms.insert(groundCondition(effect, values)));
+            else
+                pushUnique(ops.delete_atoms, ops.delete_begin.back(), atoms.insert(groundCondition(effect, values)));
+        }
+        ops.names.push_back(schema.name);
+        ops.arguments.push_back(arg);
+        ops.precondition_begin.push_back(ops.precondition_atoms.size());
+        ops.negative_begin.push_back(ops.negative_atoms.size());
+        ops.add_begin.push_back(ops.add_atoms.size());
+        ops.delete_begin.push_back(ops.delete_atoms.size());
+    }
+}
+
+void appendTranslated(vector<int> &atoms, vector<int> &begin, const vector<int> &local_atoms, const vector<int> &local_begin, const vector<int> &translation)
+{
+    int offset = atoms.size();
+    for (int atom : local_atoms)
+        atoms.push_back(translation[atom]);
+    for (size_t i = 1; i < local_begin.size(); i++)
+        begin.push_back(offset + local_begin[i]);
+}
+
+// Appends a grounded chunk to the task. Inserting the chunk's atoms in local id order
+// gives every new atom the id the serial pass would have given it.
+void mergeChunk(Task &task, GroundingChunk &chunk)
+{
+    vector<int> translation(chunk.atoms.size());
+    for (int atom = 0; atom < chunk.atoms.size(); atom++)
+        translation[atom] = task.atoms.insert(chunk.atoms.atoms[atom]);
+    OperatorTable &ops = task.operators;
+    OperatorTable &local = chunk.operators;
+    appendTranslated(ops.precondition_atoms, ops.precondition_begin, local.precondition_atoms, local.precondition_begin, translation);
+    appendTranslated(ops.negative_atoms, ops.negative_begin, local.negative_atoms, local.negative_begin, translation);
+    appendTranslated(ops.add_atoms, ops.add_begin, local.add_atoms, local.add_begin, translation);
+    appendTranslated(ops.delete_atoms, ops.delete_begin, local.delete_atoms, local.delete_begin, translation);
+    move(local.names.begin(), local.names.end(), back_inserter(ops.names));
+    move(local.arguments.begin(), local.arguments.end(), back_inserter(ops.arguments));
+    chunk.atoms = AtomTable();
+    chunk.operators = OperatorTable();
+}
+
+// Grounds every schema over the argument permutations straight into the operator table.
+// Each schema's tuples are split into chunks that options.grounding_threads workers ground
+// independently; the chunks are merged in schema and tuple order, so the task is identical
+// to a serial grounding whatever the thread count.
+void getActionArgumentCombinations(Task &task, const condition_set &initial, unordered_set<Action, ActionHasher, ActionComparator> &action_set, unordered_map<int, vector<list<string>>> &argument_permutations)
+{
+    ScopedTimer timer(statistics.grounding_time);
+    unordered_set<string> fluent_predicates;
+    for (const Action &act : action_set)
+    {
+        for (const Condition &effect : act.get_effects())
+            fluent_predicates.insert(effect.get_predicate());
+    }
+
+    vector<GroundingSchema> schemas;
+    size_t total_tuples = 0;
+    for (const Action &act : action_set)
+    {
+        list<string> parameter_list = act.get_args();
+        vector<string> parameters(parameter_list.begin(), parameter_list.end());
+        GroundingSchema schema;
+        schema.name = act.get_name();
+        for (const Condition &cond : act.get_preconditions())
+            schema.preconditions.push_back(liftCondition(cond, parameters, fluent_predicates));
+        for (const Condition &cond : act.get_effects())
+            schema.effects.push_back(liftCondition(cond, parameters, fluent_predicates));
+        // A macro was composed assuming its parameters denote objects other than its constants.
+        if (macro_library.isMacro(act.get_name()))
+        {
+            for (const Condition &cond : act.get_preconditions())
+                for (const string &a : cond.get_args())
+                    schema.macro_constants.insert(a);
+            for (const Condition &cond : act.get_effects())
+                for (const string &a : cond.get_args())
+                    schema.macro_constants.insert(a);
+            for (const string &parameter : parameters)
+                schema.macro_constants.erase(parameter);
+        }
+        schema.arguments = &argument_permutations[parameters.size()];
+        total_tuples += schema.arguments->size();
+        schemas.push_back(schema);
+    }
+
+    int threads = options.grounding_threads > 0 ? options.grounding_threads : max(1u, thread::hardware_concurrency());
+    size_t chunk_size = max<size_t>(64, total_tuples / (threads * 8) + 1);
+    vector<GroundingChunk> chunks;
+    for (const GroundingSchema &schema : schemas)
+    {
+        for (size_t begin = 0; begin < schema.arguments->size(); begin += chunk_size)
+        {
+            GroundingChunk chunk;
+            chunk.schema = &schema;
+            chunk.begin = begin;
+            chunk.end = min(begin + chunk_size, schema.arguments->size());
+            chunks.push_back(move(chunk));
+        }
+    }
+
+    threads = min<int>(threads, chunks.size());
+    if (threads <= 1)
+    {
+        for (const GroundingChunk &chunk : chunks)
+            groundChunk(chunk, initial, task.atoms, task.operators);
+        return;
+    }
+    // Workers take chunks in order while the main thread merges finished chunks in the
+    // same order, so merging overlaps with grounding; it sleeps until the next one is done.
+    atomic<size_t> next_chunk(0);
+    vector<char> grounded(chunks.size(), 0);
+    mutex grounded_mutex;
+    condition_variable grounded_changed;
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&]()
+                             {
+            for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++)
+            {
+                groundChunk(chunks[c], initial, chunks[c].atoms, chunks[c].operators);
+                {
+                    lock_guard<mutex> lock(grounded_mutex);
+                    grounded[c] = 1;
+                }
+                grounded_changed.notify_one();
+            } });
+    }
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        {
+            unique_lock<mutex> lock(grounded_mutex);
+            grounded_changed.wait(lock, [&]()
+                                  { return grounded[c] != 0; });
+        }
+        mergeChunk(task, chunks[c]);
+    }
+    for (thread &worker : workers)
+        worker.join();
+}
+
+// One predicate of a mutex invariant. The invariant's parameters are the predicate's
+// arguments without the `omitted` position (-1 when every argument is a parameter); atoms
+// with equal parameters belong to the same instance, and at most one atom of an instance
+// is true in any reachable state.
+struct InvariantPart
+{
+    string predicate;
+    int omitted;
+
+    bool operator<(const InvariantPart &rhs) const
+    {
+        return make_pair(this->predicate, this->omitted) < make_pair(rhs.predicate, rhs.omitted);
+    }
+    bool operator==(const InvariantPart &rhs) const
+    {
+        return this->predicate == rhs.predicate && this->omitted == rhs.omitted;
+    }
+};
+
+typedef vector<InvariantPart> Invariant; // sorted, at most one part per predicate
+
+vector<string> invariantInstance(const list<string> &args, int omitted)
+{
+    vector<string> instance;
+    int position = 0;
+    for (const string &arg : args)
+    {
+        if (position++ != omitted)
+            instance.push_back(arg);
+    }
+    return instance;
+}
+
+const InvariantPart *findPart(const Invariant &invariant, const string &predicate)
+{
+    for (const InvariantPart &part : invariant)
+    {
+        if (part.predicate == predicate)
+            return &part;
+    }
+    return nullptr;
+}
+
+// Schema arguments are bound to distinct symbols, so two different parameters never denote
+// the same object, while a parameter may still be bound to any constant.
+bool mayDenoteSameObjects(const vector<string> &lhs, const vector<string> &rhs, const list<string> &parameters)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (size_t i = 0; i < lhs.size(); i++)
+    {
+        bool lhs_constant = find(parameters.begin(), parameters.end(), lhs[i]) == parameters.end();
+        bool rhs_constant = find(parameters.begin(), parameters.end(), rhs[i]) == parameters.end();
+        if (lhs[i] != rhs[i] && lhs_constant == rhs_constant)
+            return false;
+    }
+    return true;
+}
+
+// Checks that `act` cannot make two atoms of one instance of `invariant` true: every add
+// effect in the invariant must be paired with a deleted precondition of the same instance.
+// On failure, fills `refinements` with larger candidates that would balance the action.
+bool checkInvariantBalance(const Action &act, const Invariant &invariant, vector<Invariant> &refinements)
+{
+    list<string> parameters = act.get_args();
+    unordered_set<Condition, ConditionHasher, ConditionComparator> preconditions = act.get_preconditions();
+    vector<Condition> adds;
+    vector<Condition> deletes;
+    for (const Condition &effect : act.get_effects())
+    {
+        if (effect.get_truth())
+            adds.push_back(effect);
+        else
+            deletes.push_back(effect);
+    }
+
+    vector<pair<Condition, vector<string>>> added;
+    for (const Condition &add : adds)
+    {
+        const InvariantPart *part = findPart(invariant, add.get_predicate());
+        if (part == nullptr)
+            continue;
+        vector<string> instance = invariantInstance(add.get_args(), part->omitted);
+        for (const pair<Condition, vector<string>> &other : added)
+        {
+            if (mayDenoteSameObjects(other.second, instance, parameters))
+                return false;
+        }
+        added.push_back(make_pair(add, instance));
+    }
+
+    for (const pair<Condition, vector<string>> &add : added)
+    {
+        bool balanced = false;
+        for (const Condition &del : deletes)
+        {
+            const InvariantPart *part = findPart(invariant, del.get_predicate());
+            Condition positive = Condition(del.get_predicate(), del.get_args(), true);
+            if (part == nullptr || positive == add.first || preconditions.find(positive) == preconditions.end())
+                continue;
+            if (find(adds.begin(), adds.end(), positive) != adds.end())
+                continue;
+            if (invariantInstance(del.get_args(), part->omitted) == add.second)
+                balanced = true;
+        }
+        if (balanced)
+            continue;
+
+        for (const Condition &del : deletes)
+        {
+            Condition positive = Condition(del.get_predicate(), del.get_args(), true);
+            if (findPart(invariant, del.get_predicate()) != nullptr || preconditions.find(positive) == preconditions.end())
+                continue;
+            for (int omitted = -1; omitted < (int)del.get_args().size(); omitted++)
+            {
+                if (invariantInstance(del.get_args(), omitted) != add.second)
+                    continue;
+                Invariant refined = invariant;
+                refined.push_back(InvariantPart{del.get_predicate(), omitted});
+                sort(refined.begin(), refined.end());
+                refinements.push_back(refined);
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+// Invariant synthesis over the action schemas: starts from one candidate per fluent
+// predicate and argument position and refines unbalanced candidates by the predicates the
+// offending action deletes, keeping every candidate that all schemas respect. Whether the
+// initial state satisfies an invariant is checked when it is instantiated.
+vector<Invariant> synthesizeInvariants(const unordered_set<Action, ActionHasher, ActionComparator> &action_set)
+{
+    const size_t max_parts = 4;
+    const int max_candidates = 2000;
+    map<string, int> fluent_arity;
+    for (const Action &act : action_set)
+    {
+        for (const Condition &effect : act.get_effects())
+            fluent_arity[effect.get_predicate()] = effect.get_args().size();
+    }
+
+    queue<Invariant> candidates;
+    set<Invariant> seen;
+    for (const pair<const string, int> &predicate : fluent_arity)
+    {
+        for (int omitted = -1; omitted < predicate.second; omitted++)
+        {
+            Invariant candidate = {InvariantPart{predicate.first, omitted}};
+            seen.insert(candidate);
+            candidates.push(candidate);
+        }
+    }
+
+    vector<Invariant> invariants;
+    int checked = 0;
+    while (!candidates.empty() && checked++ < max_candidates)
+    {
+        Invariant candidate = candidates.front();
+        candidates.pop();
+        bool balanced = true;
+        for (const Action &act : action_set)
+        {
+            vector<Invariant> refinements;
+            if (checkInvariantBalance(act, candidate, refinements))
+                continue;
+            balanced = false;
+            for (const Invariant &refined : refinements)
+            {
+                if (refined.size() <= max_parts && seen.insert(refined).second)
+                    candidates.push(refined);
+            }
+            break;
+        }
+        if (balanced)
+            invariants.push_back(candidate);
+    }
+    return invariants;
+}
+
+// Instantiates the invariants over the grounded atoms. An invariant with an instance that
+// has two atoms true in the initial state does not hold and is dropped as a whole.
+vector<vector<int>> instantiateMutexGroups(const AtomTable &atoms, const vector<Invariant> &invariants, const condition_set &initial)
+{
+    set<vector<int>> groups;
+    for (const Invariant &invariant : invariants)
+    {
+        map<pair<vector<string>, size_t>, vector<int>> instances;
+        for (int atom = 0; atom < atoms.size(); atom++)
+        {
+            const GroundedCondition &condition = atoms.atoms[atom];
+            const InvariantPart *part = findPart(invariant, condition.get_predicate());
+            if (part == nullptr)
+                continue;
+            list<string> args = condition.get_arg_values();
+            instances[make_pair(invariantInstance(args, part->omitted), args.size() - (part->omitted >= 0))].push_back(atom);
+        }
+        bool holds_initially = true;
+        for (const auto &instance : instances)
+        {
+            int true_atoms = 0;
+            for (int atom : instance.second)
+                true_atoms += initial.find(atoms.atoms[atom]) != initial.end();
+            holds_initially = holds_initially && true_atoms <= 1;
+        }
+        if (!holds_initially)
+            continue;
+        for (const auto &instance : instances)
+        {
+            if (instance.second.size() > 1)
+                groups.insert(instance.second);
+        }
+    }
+    return vector<vector<int>>(groups.begin(), groups.end());
+}
+
+// Drops operators whose preconditions contain two atoms of one mutex group; they can never
+// be applied in a reachable state.
+void pruneMutexOperators(OperatorTable &ops, const vector<vector<int>> &mutex_groups, int num_atoms)
+{
+    vector<vector<int>> groups_of_atom(num_atoms);
+    for (size_t group = 0; group < mutex_groups.size(); group++)
+    {
+        for (int atom : mutex_groups[group])
+            groups_of_atom[atom].push_back(group);
+    }
+    OperatorTable pruned;
+    vector<int> marked_by(mutex_groups.size(), -1);
+    for (int op = 0; op < ops.size(); op++)
+    {
+        bool reachable = true;
+        for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1] && reachable; i++)
+        {
+            for (int group : groups_of_atom[ops.precondition_atoms[i]])
+            {
+                if (marked_by[group] == op)
+                    reachable = false;
+                marked_by[group] = op;
+            }
+        }
+        if (!reachable)
+            continue;
+        pruned.names.push_back(ops.names[op]);
+        pruned.arguments.push_back(ops.arguments[op]);
+        pruned.precondition_atoms.insert(pruned.precondition_atoms.end(), ops.precondition_atoms.begin() + ops.precondition_begin[op], ops.precondition_atoms.begin() + ops.precondition_begin[op + 1]);
+        pruned.negative_atoms.insert(pruned.negative_atoms.end(), ops.negative_atoms.begin() + ops.negative_begin[op], ops.negative_atoms.begin() + ops.negative_begin[op + 1]);
+        pruned.add_atoms.insert(pruned.add_atoms.end(), ops.add_atoms.begin() + ops.add_begin[op], ops.add_atoms.begin() + ops.add_begin[op + 1]);
+        pruned.delete_atoms.insert(pruned.delete_atoms.end(), ops.delete_atoms.begin() + ops.delete_begin[op], ops.delete_atoms.begin() + ops.delete_begin[op + 1]);
+        pruned.precondition_begin.push_back(pruned.precondition_atoms.size());
+        pruned.negative_begin.push_back(pruned.negative_atoms.size());
+        pruned.add_begin.push_back(pruned.add_atoms.size());
+        pruned.delete_begin.push_back(pruned.delete_atoms.size());
+    }
+    ops = pruned;
+}
+
+// Finite-domain re-encoding: mutex groups are picked greedily, largest first, as
+// multi-valued variables (value i means the i-th atom holds, the last value none of them);
+// atoms left over become binary variables. Each variable takes just enough bits to store
+// its value.
+StateEncoding buildStateEncoding(int num_atoms, const vector<vector<int>> &mutex_groups)
+{
+    StateEncoding encoding;
+    vector<char> covered(num_atoms, 0);
+    vector<vector<int>> remaining = mutex_groups;
+    while (true)
+    {
+        for (vector<int> &group : remaining)
+        {
+            group.erase(remove_if(group.begin(), group.end(), [&](int atom)
+                                  { return covered[atom]; }),
+                        group.end());
+        }
+        auto largest = max_element(remaining.begin(), remaining.end(), [](const vector<int> &a, const vector<int> &b)
+                                   { return a.size() < b.size(); });
+        if (largest == remaining.end() || largest->size() < 2)
+            break;
+        for (int atom : *largest)
+            covered[atom] = 1;
+        encoding.variable_atoms.push_back(*largest);
+        largest->clear();
+    }
+    for (int atom = 0; atom < num_atoms; atom++)
+    {
+        if (!covered[atom])
+            encoding.variable_atoms.push_back(vector<int>{atom});
+    }
+
+    int offset = 0;
+    for (const vector<int> &atoms : encoding.variable_atoms)
+    {
+        int width = 1;
+        while ((1 << width) < (int)atoms.size() + 1)
+            width++;
+        encoding.bit_offset.push_back(offset);
+        encoding.bit_width.push_back(width);
+        offset += width;
+    }
+    encoding.packed_bytes = (offset + 7) / 8;
+    return encoding;
+}
+
+// Indexes the operators of `task` by precondition atom for goalRelaxedReachable().
+void buildPreconditionIndex(Task &task)
+{
+    const OperatorTable &ops = task.operators;
+    task.precondition_of_begin.assign(task.atoms.size() + 1, 0);
+    for (int atom : ops.precondition_atoms)
+        task.precondition_of_begin[atom + 1]++;
+    for (int atom = 0; atom < task.atoms.size(); atom++)
+        task.precondition_of_begin[atom + 1] += task.precondition_of_begin[atom];
+    task.precondition_of.resize(ops.precondition_atoms.size());
+    vector<int> next(task.precondition_of_begin.begin(), task.precondition_of_begin.end() - 1);
+    for (int op = 0; op < ops.size(); op++)
+    {
+        for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+            task.precondition_of[next[ops.precondition_atoms[i]]++] = op;
+        if (ops.precondition_begin[op] == ops.precondition_begin[op + 1])
+            task.unconditional_operators.push_back(op);
+    }
+}
+
+// Builds the structures derived from a task's operator table; every function that creates
+// or filters a Task calls it last.
+void finalizeTask(Task &task)
+{
+    task.applicability = buildApplicabilityMatrix(task);
+    buildPreconditionIndex(task);
+}
+
+// Invariants of the loaded domain when a problem stream shares one; synthesized per task
+// otherwise.
+const vector<Invariant> *domain_invariants = nullptr;
+
+// Grounds `env` into a Task. Initial atoms of static predicates only enter the state
+// when they are goals, since no operator reads them after grounding.
+Task buildTask(Env *env)
+{
+    Task task;
+    condition_set start = env->get_inital_conditions();
+    condition_set goal = env->get_goal_conditions();
+    unordered_set<Action, ActionHasher, ActionComparator> primitive_actions = env->get_all_actions();
+    unordered_set<Action, ActionHasher, ActionComparator> action_set = primitive_actions;
+    for (const Action &macro : macro_library.compile(env))
+        action_set.insert(macro);
+    vector<string> arguments = get_arguements(start);
+
+    vector<pair<string, int>> action_names = getActionNames(action_set);
+    unordered_map<int, vector<list<string>>> argument_permutations;
+    {
+        ScopedTimer timer(statistics.grounding_time);
+        for (size_t i = 0; i < action_names.size(); i++)
+        {
+            if (argument_permutations.find(action_names[i].second) == argument_permutations.end())
+            {
+                argument_permutations[action_names[i].second] = getPermuations(arguments, action_names[i].second);
+            }
+        }
+    }
+    getActionArgumentCombinations(task, start, action_set, argument_permutations);
+
+    for (const GroundedCondition &g : goal)
+        task.goal_atoms.push_back(task.atoms.insert(g));
+    {
+        ScopedTimer timer(statistics.grounding_time);
+        task.mutex_groups = instantiateMutexGroups(task.atoms, domain_invariants != nullptr ? *domain_invariants : synthesizeInvariants(primitive_actions), start);
+        pruneMutexOperators(task.operators, task.mutex_groups, task.atoms.size());
+        task.encoding = buildStateEncoding(task.atoms.size(), task.mutex_groups);
+    }
+    task.state_words = (task.atoms.size() + 63) / 64;
+    task.initial_state = emptyState(task);
+    for (const GroundedCondition &c : start)
+    {
+        int atom = task.atoms.find(c.toString());
+        if (atom >= 0)
+            addAtom(task.initial_state, atom);
+    }
+    task.is_goal.assign(task.atoms.size(), 0);
+    for (int atom : task.goal_atoms)
+        task.is_goal[atom] = 1;
+    finalizeTask(task);
+    return task;
+}
+
+// Hex encoding of a packed state, used as a sortable key in external search files.
+string stateToString(const PackedState &state)
+{
+    static const char digits[] = "0123456789abcdef";
+    string state_string;
+    for (unsigned char byte : state)
+    {
+        state_string += digits[byte >> 4];
+        state_string += digits[byte & 15];
+    }
+    return state_string;
+}
+
+PackedState stringToState(const string &state_string)
+{
+    PackedState state(state_string.size() / 2, '\0');
+    for (size_t i = 0; i < state_string.size(); i++)
+    {
+        char c = state_string[i];
+        int digit = c <= '9' ? c - '0' : c - 'a' + 10;
+        state[i / 2] = (char)((state[i / 2] << 4) | digit);
+    }
+    return state;
+}
+
+int countUnsatisfiedGoals(const Task &task, const State &current)
+{
+    int count = 0;
+    for (int atom : task.goal_atoms)
+    {
+        if (!holds(current, atom))
+            count++;
+    }
+    return count;
+}
+
+// Unsatisfied goal count of the successor of `parent` under `op`, computed from the
+// parent's count by looking only at the operator's effects. Relaxed successors ignore
+// delete effects.
+int unsatisfiedGoalsAfter(const Task &task, const State &parent, int op, int parent_unsatisfied_goals, bool relaxed = false)
+{
+    const OperatorTable &ops = task.operators;
+    int count = parent_unsatisfied_goals;
+    for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+    {
+        int atom = ops.add_atoms[i];
+        if (task.is_goal[atom] && !holds(parent, atom))
+            count--;
+    }
+    if (relaxed)
+        return count;
+    for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+    {
+        int atom = ops.delete_atoms[i];
+        if (!task.is_goal[atom] || !holds(parent, atom))
+            continue;
+        // an operator that adds and deletes the same atom leaves it true
+        bool added = false;
+        for (int j = ops.add_begin[op]; j < ops.add_begin[op + 1]; j++)
+            added = added || ops.add_atoms[j] == atom;
+        if (!added)
+            count++;
+    }
+    return count;
+}
+
+bool checkGoal(const Task &task, const State &current)
+{
+    return countUnsatisfiedGoals(task, current) == 0;
+}
+struct Node
+{
+    State state_;
+    double g_value_;
+    double f_value_;
+    int unsatisfied_goals_;
+    int action_; // operator that generated the node, -1 for the start node
+    Node()
+    {
+        g_value_ = 0;
+        f_value_ = 0;
+        unsatisfied_goals_ = 0;
+        action_ = -1;
+    }
+    Node(State state, int action, double g_value, double f_value, int unsatisfied_goals = 0) : state_(state), g_value_(g_value), f_value_(f_value), unsatisfied_goals_(unsatisfied_goals), action_(action) {}
+};
+struct CompareNode
+{
+    bool operator()(Node const &n1, Node const &n2)
+    {
+        return n1.f_value_ > n2.f_value_;
+    }
+};
+
+typedef unordered_map<State, double, StateHasher> g_value_map;
+typedef unordered_map<State, Node, StateHasher> parent_map;
+
+// Search bookkeeping keyed by packed states, so the closed list, g values and parent links
+// cost a few bytes per state instead of a bit vector over all atoms.
+struct ParentLink
+{
+    PackedState parent;
+    int action;
+};
+
+typedef unordered_set<PackedState> packed_state_set;
+typedef unordered_map<PackedState, double> packed_g_value_map;
+typedef unordered_map<PackedState, ParentLink> parent_link_map;
+
+list<int> backTrackOperators(parent_map &came_from, const State &start, Node goal)
+{
+    list<int> operators;
+    Node current_state = goal;
+    while (current_state.state_ != start) // Backtracking to get the shortest path
+    {
+        operators.push_back(current_state.action_);
+        current_state = came_from[current_state.state_];
+    }
+    return operators;
+}
+
+list<GroundedAction> backTrack(const Task &task, parent_link_map &came_from, const PackedState &start, PackedState goal)
+{
+    list<GroundedAction> actions;
+    PackedState current_state = goal;
+    while (current_state != start)
+    {
+        const ParentLink &link = came_from[current_state];
+        actions.push_back(getGroundedAction(task, link.action));
+        current_state = link.parent;
+    }
+    return actions;
+}
+double getHeuristic(int unsatisfied_goals, int heuristic)
+{
+    if(heuristic == 0){
+        return 0;
+    }
+    if (heuristic == 1){
+        int weight = 10;
+        return weight*unsatisfied_goals;
+    }
+    return 0;
+}
+
+void expandActionsAndArgumentsHeuristic(priority_queue<Node, vector<Node>, CompareNode> &open_list, g_value_map &g_value_list,
+                               state_set &closed_list, const Task &task, parent_map &came_from,
+                               Node &current_node, double edge_cost)
+{
+    vector<int> applicable;
+    applicableOperators(task, current_node.state_, applicable);
+    for (int op : applicable)
+    {
+        State neighbour = applyActionHeuristic(task, current_node.state_, op);
+        if (closed_list.find(neighbour) == closed_list.end())
+        {
+            double neighbour_g_value = current_node.g_value_ + edge_cost;
+            auto neighbour_openlist = g_value_list.find(neighbour);
+            if (neighbour_openlist == g_value_list.end() || neighbour_g_value < neighbour_openlist->second)
+            {
+                int neighbour_unsatisfied_goals = unsatisfiedGoalsAfter(task, current_node.state_, op, current_node.unsatisfied_goals_, true);
+                Node neighbour_node = Node(neighbour, op, neighbour_g_value, INT_MAX, neighbour_unsatisfied_goals);
+                neighbour_node.f_value_ = neighbour_node.g_value_;
+                open_list.push(neighbour_node);
+                g_value_list[neighbour] = neighbour_g_value;
+                came_from[neighbour] = current_node;
+            }
+        }
+    }
+}
+
+
+// LRU table of exact relaxed goal distances, shared by every search over the task. Keys are
+// relaxed states, which may break mutex groups, so they are stored unpacked.
+class RelaxedDistanceCache
+{
+private:
+    typedef list<pair<State, double>> entry_list;
+    entry_list entries; // most recently used first
+    unordered_map<State, entry_list::iterator, StateHasher> index;
+    size_t bytes = 0;
+    mutex cache_mutex;
+
+    static size_t entryBytes(const State &state)
+    {
+        // list node, hash node and bucket, plus the state's words stored twice
+        return 2 * state.size() * sizeof(uint64_t) + 2 * sizeof(pair<State, double>) + 6 * sizeof(void *);
+    }
+
+public:
+    bool find(const State &state, double &distance)
+    {
+        lock_guard<mutex> lock(this->cache_mutex);
+        auto entry = this->index.find(state);
+        if (entry == this->index.end())
+            return false;
+        this->entries.splice(this->entries.begin(), this->entries, entry->second);
+        distance = entry->second->second;
+        return true;
+    }
+
+    void insert(const State &state, double distance)
+    {
+        lock_guard<mutex> lock(this->cache_mutex);
+        size_t entry_bytes = entryBytes(state);
+        if (entry_bytes > options.heuristic_cache_bytes || this->index.find(state) != this->index.end())
+            return;
+        while (this->bytes + entry_bytes > options.heuristic_cache_bytes)
+        {
+            this->bytes -= entryBytes(this->entries.back().first);
+            this->index.erase(this->entries.back().first);
+            this->entries.pop_back();
+        }
+        this->entries.emplace_front(state, distance);
+        this->index[state] = this->entries.begin();
+        this->bytes += entry_bytes;
+    }
+
+    // Distances are to the task's goals; call whenever they change.
+    void clear()
+    {
+        lock_guard<mutex> lock(this->cache_mutex);
+        this->entries.clear();
+        this->index.clear();
+        this->bytes = 0;
+    }
+};
+
+RelaxedDistanceCache relaxed_distance_cache;
+
+// Length of a shortest delete-relaxed plan from `start`, infinity if the goal is relaxed
+// unreachable. Every state on the extracted relaxed path gets its exact distance cached.
+double getAdmissibleHeuristic(const Task &task, const State &start){
+    double cached;
+    if (relaxed_distance_cache.find(start, cached))
+    {
+        statistics.heuristic_cache_hits++;
+        return cached;
+    }
+    statistics.heuristic_cache_misses++;
+    Node start_node = Node(start, -1, 0, 0, countUnsatisfiedGoals(task, start));
+    Node goal_node;
+    Node current_node = start_node;
+    parent_map came_from;
+    priority_queue<Node, vector<Node>, CompareNode> open_list;
+    state_set closed_list;
+    g_value_map g_value_list;
+    double edge_cost = 1;
+    bool found = false;
+    open_list.push(start_node);
+    g_value_list[start_node.state_] = start_node.g_value_;
+    long polls = 0;
+    while (!open_list.empty())
+    {
+        // The value no longer matters once the search is stopping; its monitor notices next.
+        if (search_cancelled || (++polls % 256 == 0 && timeLimitReached()))
+            return 0;
+        current_node = open_list.top();
+        open_list.pop();
+        closed_list.insert(current_node.state_);
+        if (current_node.unsatisfied_goals_ == 0)
+        {
+            goal_node = current_node;
+            found = true;
+            break;
+        }
+        expandActionsAndArgumentsHeuristic(open_list, g_value_list, closed_list, task, came_from, current_node, edge_cost);
+    }
+    if (!found)
+    {
+        relaxed_distance_cache.insert(start, numeric_limits<double>::infinity());
+        return numeric_limits<double>::infinity();
+    }
+    // Suffixes of a shortest path are shortest, so each state on it is `distance` from the goal.
+    double distance = 0;
+    for (Node node = goal_node; ; node = came_from[node.state_], distance++)
+    {
+        relaxed_distance_cache.insert(node.state_, distance);
+        if (node.state_ == start)
+            break;
+    }
+    return distance;
+}
+
+// Relaxed reachability as in h_max: ignoring delete effects and negative preconditions,
+// an operator fires once all its preconditions are reached, and its add effects are then
+// reached. Counting the unreached preconditions of each operator makes this linear in the
+// size of the task; the counters are reset lazily by stamp and the exploration stops once
+// every goal is reached, so most calls touch a small part of it. Returns false when some
+// goal atom stays unreached, which proves that no plan starts in `state`.
+bool goalRelaxedReachable(const Task &task, const State &state)
+{
+    const OperatorTable &ops = task.operators;
+    thread_local vector<int> unreached_preconditions;
+    thread_local vector<unsigned> operator_stamp;
+    thread_local vector<unsigned> atom_stamp;
+    thread_local vector<int> queue;
+    thread_local unsigned stamp = 0;
+    if (operator_stamp.size() != (size_t)ops.size() || atom_stamp.size() != (size_t)task.atoms.size() || ++stamp == 0)
+    {
+        unreached_preconditions.assign(ops.size(), 0);
+        operator_stamp.assign(ops.size(), 0);
+        atom_stamp.assign(task.atoms.size(), 0);
+        stamp = 1;
+    }
+    queue.clear();
+    int unreached_goals = task.goal_atoms.size();
+    auto reach = [&](int atom)
+    {
+        if (atom_stamp[atom] == stamp)
+            return;
+        atom_stamp[atom] = stamp;
+        unreached_goals -= task.is_goal[atom];
+        queue.push_back(atom);
+    };
+    auto fire = [&](int op)
+    {
+        for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+            reach(ops.add_atoms[i]);
+    };
+    for (size_t w = 0; w < state.size(); w++)
+    {
+        for (uint64_t bits = state[w]; bits; bits &= bits - 1)
+            reach(w * 64 + __builtin_ctzll(bits));
+    }
+    for (int op : task.unconditional_operators)
+        fire(op);
+    for (size_t next = 0; next < queue.size() && unreached_goals > 0; next++)
+    {
+        int atom = queue[next];
+        for (int i = task.precondition_of_begin[atom]; i < task.precondition_of_begin[atom + 1]; i++)
+        {
+            int op = task.precondition_of[i];
+            if (operator_stamp[op] != stamp)
+            {
+                operator_stamp[op] = stamp;
+                unreached_preconditions[op] = ops.precondition_begin[op + 1] - ops.precondition_begin[op];
+            }
+            if (--unreached_preconditions[op] == 0)
+                fire(op);
+        }
+    }
+    return unreached_goals == 0;
+}
+
+// Infinite for a state proven to be a dead end, which every search prunes.
+double evaluateHeuristic(const Task &task, const State &state, int unsatisfied_goals, int heuristic)
+{
+    ScopedTimer timer(statistics.heuristic_time);
+    double h;
+    if (heuristic == 2)
+        h = getAdmissibleHeuristic(task, state);
+    else if (options.dead_end_pruning && unsatisfied_goals > 0 && !goalRelaxedReachable(task, state))
+        h = numeric_limits<double>::infinity();
+    else
+        h = getHeuristic(unsatisfied_goals, heuristic);
+    if (isinf(h))
+        statistics.dead_ends++;
+    return h;
+}
+
+void expandActionsAndArguments(priority_queue<Node, vector<Node>, CompareNode> &open_list, packed_g_value_map &g_value_list,
+                               packed_state_set &closed_list, const Task &task, parent_link_map &came_from,
+                               Node &current_node, const PackedState &current_packed, double edge_cost,int heuristic)
+{
+    vector<int> applicable;
+    {
+        ScopedTimer timer(statistics.successor_time);
+        applicableOperators(task, current_node.state_, applicable);
+    }
+    for (int op : applicable)
+    {
+        State neighbour;
+        int neighbour_unsatisfied_goals;
+        {
+            ScopedTimer timer(statistics.successor_time);
+            neighbour = applyAction(task, current_node.state_, op);
+            neighbour_unsatisfied_goals = unsatisfiedGoalsAfter(task, current_node.state_, op, current_node.unsatisfied_goals_);
+        }
+        statistics.generated++;
+        double neighbour_g_value = current_node.g_value_ + edge_cost;
+        PackedState neighbour_packed;
+        {
+            ScopedTimer timer(statistics.hashing_time);
+            neighbour_packed = packState(task, neighbour);
+            // Every generated state has a g value, closed ones included.
+            auto neighbour_openlist = g_value_list.find(neighbour_packed);
+            if (neighbour_openlist != g_value_list.end() && neighbour_g_value >= neighbour_openlist->second)
+                continue;
+        }
+        Node neighbour_node = Node(neighbour, op, neighbour_g_value, INT_MAX, neighbour_unsatisfied_goals);
+        neighbour_node.f_value_ = neighbour_node.g_value_ + evaluateHeuristic(task, neighbour_node.state_, neighbour_unsatisfied_goals, heuristic);
+        if (isinf(neighbour_node.f_value_))
+            continue;
+        // A cheaper path to a closed state, possible with the inadmissible heuristic.
+        if (closed_list.erase(neighbour_packed) > 0)
+            statistics.reopened++;
+        open_list.push(neighbour_node);
+        g_value_list[neighbour_packed] = neighbour_g_value;
+        came_from[neighbour_packed] = ParentLink{current_packed, op};
+    }
+}
+
+// Approximate heap footprint of a state held in a Node or hash table.
+size_t stateBytes(const PackedState &state)
+{
+    // std::string keeps up to 15 bytes inline
+    return sizeof(PackedState) + (state.size() > 15 ? state.capacity() + 1 : 0);
+}
+
+void writeStatistics(const string &filename)
+{
+    ofstream out(filename);
+    if (!out.is_open())
+    {
+        cout << "Unable to write statistics to " << filename << endl;
+        return;
+    }
+    double bytes_per_state = statistics.expanded > 0 ? statistics.state_bytes / statistics.expanded : 0;
+    out << "{" << endl;
+    out << "  \"status\": \"" << searchStatusName(statistics.status) << "\"," << endl;
+    if (statistics.status == SEARCH_LIMIT_REACHED)
+        out << "  \"limit\": \"" << statistics.limit << "\"," << endl;
+    out << "  \"phases\": {" << endl;
+    out << "    \"parse_s\": " << statistics.parse_time << "," << endl;
+    out << "    \"grounding_s\": " << statistics.grounding_time << "," << endl;
+    out << "    \"search_s\": " << statistics.search_time << "," << endl;
+    out << "    \"successor_generation_s\": " << statistics.successor_time << "," << endl;
+    out << "    \"heuristic_s\": " << statistics.heuristic_time << "," << endl;
+    out << "    \"hashing_s\": " << statistics.hashing_time << "," << endl;
+    out << "    \"backtrack_s\": " << statistics.backtrack_time << endl;
+    out << "  }," << endl;
+    out << "  \"grounded_actions\": " << statistics.grounded_actions << "," << endl;
+    out << "  \"generated\": " << statistics.generated << "," << endl;
+    out << "  \"expanded\": " << statistics.expanded << "," << endl;
+    out << "  \"reopened\": " << statistics.reopened << "," << endl;
+    out << "  \"heuristic_cache_hits\": " << statistics.heuristic_cache_hits << "," << endl;
+    out << "  \"heuristic_cache_misses\": " << statistics.heuristic_cache_misses << "," << endl;
+    out << "  \"dead_ends\": " << statistics.dead_ends << "," << endl;
+    out << "  \"expected_omissions\": " << statistics.expected_omissions << "," << endl;
+    out << "  \"sat_conflicts\": " << statistics.sat_conflicts << "," << endl;
+    out << "  \"sat_decisions\": " << statistics.sat_decisions << "," << endl;
+    out << "  \"open_list_peak\": " << statistics.open_list_peak << "," << endl;
+    out << "  \"bytes_per_state\": " << bytes_per_state << "," << endl;
+    out << "  \"peak_memory_kb\": " << peakMemoryKB() << "," << endl;
+    out << "  \"plan_length\": " << statistics.plan_length << "," << endl;
+    out << "  \"memory_samples\": [";
+    for (size_t i = 0; i < statistics.memory_samples.size(); i++)
+    {
+        const MemorySample &sample = statistics.memory_samples[i];
+        out << (i == 0 ? "" : ",") << endl
+            << "    {\"expanded\": " << sample.expanded << ", \"open\": " << sample.open_list_size
+            << ", \"closed\": " << sample.closed_list_size << ", \"resident_kb\": " << sample.resident_kb << "}";
+    }
+    out << endl
+        << "  ]" << endl;
+    out << "}" << endl;
+}
+
+// One line of an external bucket file: state, parent state and the action between them,
+// separated by tabs. Files are sorted by the whole line, hence by state first.
+struct ExternalRecord
+{
+    string state;
+    string parent;
+    string action;
+};
+
+ExternalRecord parseExternalRecord(const string &line)
+{
+    ExternalRecord record;
+    size_t first = line.find('\t');
+    size_t second = line.find('\t', first + 1);
+    record.state = line.substr(0, first);
+    record.parent = line.substr(first + 1, second - first - 1);
+    record.action = line.substr(second + 1);
+    return record;
+}
+
+string externalRecordKey(const string &line)
+{
+    return line.substr(0, line.find('\t'));
+}
+
+// Sorts `input` into `output` keeping one line per state, holding at most
+// `buffer_bytes` of lines in memory at a time (external merge sort).
+void sortUniqueExternal(const string &input, const string &output, const string &directory, size_t buffer_bytes)
+{
+    ifstream in(input);
+    vector<string> runs;
+    vector<string> buffer;
+    size_t bytes = 0;
+    string line;
+    auto flush = [&]()
+    {
+        if (buffer.empty())
+            return;
+        sort(buffer.begin(), buffer.end());
+        string run = directory + "/run_" + to_string(runs.size());
+        ofstream out(run);
+        for (const string &l : buffer)
+            out << l << '\n';
+        runs.push_back(run);
+        buffer.clear();
+        bytes = 0;
+    };
+    while (getline(in, line))
+    {
+        bytes += line.size() + sizeof(string);
+        buffer.push_back(line);
+        if (bytes >= buffer_bytes)
+            flush();
+    }
+    flush();
+
+    vector<ifstream> readers;
+    for (const string &run : runs)
+        readers.emplace_back(run);
+    typedef pair<string, size_t> head;
+    priority_queue<head, vector<head>, greater<head>> heads;
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        if (getline(readers[i], line))
+            heads.push(make_pair(line, i));
+    }
+    ofstream out(output);
+    string last_key;
+    bool first = true;
+    while (!heads.empty())
+    {
+        head top = heads.top();
+        heads.pop();
+        string key = externalRecordKey(top.first);
+        if (first || key != last_key)
+        {
+            out << top.first << '\n';
+            last_key = key;
+            first = false;
+        }
+        if (getline(readers[top.second], line))
+            heads.push(make_pair(line, top.second));
+    }
+    for (const string &run : runs)
+        remove(run.c_str());
+}
+
+// Writes the lines of sorted `input` whose state does not occur in sorted `closed`.
+void subtractSortedExternal(const string &input, const string &closed, const string &output)
+{
+    ifstream in(input);
+    ifstream removed(closed);
+    ofstream out(output);
+    string line, removed_line;
+    bool has_removed = static_cast<bool>(getline(removed, removed_line));
+    while (getline(in, line))
+    {
+        string key = externalRecordKey(line);
+        while (has_removed && externalRecordKey(removed_line) < key)
+            has_removed = static_cast<bool>(getline(removed, removed_line));
+        if (!has_removed || externalRecordKey(removed_line) != key)
+            out << line << '\n';
+    }
+}
+
+// External-memory A*: open and closed sets live in one file per (g, h) bucket under a
+// scratch directory. Successors are appended to their bucket unsorted; a bucket is sorted,
+// deduplicated and subtracted against earlier closed buckets of the same h only when it is
+// expanded (delayed duplicate detection). Buckets are expanded in order of f, then g.
+list<GroundedAction> externalAStar(const Task &task, int heuristic)
+{
+    string directory_template = options.external_directory + "/planner_XXXXXX";
+    vector<char> directory_buffer(directory_template.begin(), directory_template.end());
+    directory_buffer.push_back('\0');
+    if (mkdtemp(directory_buffer.data()) == nullptr)
+        throw runtime_error("Unable to create scratch directory in " + options.external_directory);
+    string directory = directory_buffer.data();
+    size_t buffer_bytes = options.external_buffer_mb * 1024 * 1024;
+
+    auto bucketFile = [&](int g, int h, const string &kind)
+    {
+        return directory + "/" + kind + "_" + to_string(g) + "_" + to_string(h);
+    };
+    auto evaluate = [&](const State &state, int unsatisfied_goals)
+    {
+        double h = evaluateHeuristic(task, state, unsatisfied_goals, heuristic);
+        return isinf(h) ? -1 : (int)lround(h); // -1 marks a dead end
+    };
+
+    set<pair<int, int>> open_buckets;                  // (g, h) with pending successors
+    map<int, vector<pair<int, string>>> closed_buckets; // h -> (g, closed file)
+    vector<string> scratch_files;
+
+    string start_string = stateToString(packState(task, task.initial_state));
+    int start_h = evaluate(task.initial_state, countUnsatisfiedGoals(task, task.initial_state));
+    {
+        ofstream out(bucketFile(0, start_h, "open"));
+        out << start_string << '\t' << '\t' << '\n';
+    }
+    open_buckets.insert(make_pair(0, start_h));
+
+    bool found = false;
+    int goal_g = 0;
+    ExternalRecord goal_record;
+    long closed_states = 0;
+    bool stopped = false;
+    SearchMonitor monitor;
+    while (!open_buckets.empty() && !found && !stopped)
+    {
+        pair<int, int> bucket = *min_element(open_buckets.begin(), open_buckets.end(),
+                                             [](const pair<int, int> &a, const pair<int, int> &b)
+                                             { return make_pair(a.first + a.second, a.first) < make_pair(b.first + b.second, b.first); });
+        open_buckets.erase(bucket);
+        int g = bucket.first;
+        int h = bucket.second;
+
+        string open_file = bucketFile(g, h, "open");
+        string sorted_file = bucketFile(g, h, "sorted");
+        {
+            ScopedTimer timer(statistics.hashing_time);
+            sortUniqueExternal(open_file, sorted_file, directory, buffer_bytes);
+            remove(open_file.c_str());
+            for (const pair<int, string> &closed : closed_buckets[h])
+            {
+                if (closed.first > g)
+                    continue;
+                string difference_file = bucketFile(g, h, "difference");
+                subtractSortedExternal(sorted_file, closed.second, difference_file);
+                rename(difference_file.c_str(), sorted_file.c_str());
+            }
+        }
+        string closed_file = bucketFile(g, h, "closed") + "_" + to_string(closed_buckets[h].size());
+        rename(sorted_file.c_str(), closed_file.c_str());
+        closed_buckets[h].push_back(make_pair(g, closed_file));
+        scratch_files.push_back(closed_file);
+
+        map<int, ofstream> successor_writers;
+        ifstream in(closed_file);
+        string line;
+        while (getline(in, line))
+        {
+            ExternalRecord record = parseExternalRecord(line);
+            State state = unpackState(task, stringToState(record.state));
+            int unsatisfied_goals = countUnsatisfiedGoals(task, state);
+            closed_states++;
+            if (unsatisfied_goals == 0)
+            {
+                found = true;
+                goal_g = g;
+                goal_record = record;
+                break;
+            }
+            stopped = monitor.stop(g + h, h);
+            if (stopped)
+                break;
+            statistics.expanded++;
+            vector<int> applicable;
+            {
+                ScopedTimer timer(statistics.successor_time);
+                applicableOperators(task, state, applicable);
+            }
+            for (int op : applicable)
+            {
+                State neighbour;
+                int neighbour_unsatisfied_goals;
+                {
+                    ScopedTimer timer(statistics.successor_time);
+                    neighbour = applyAction(task, state, op);
+                    neighbour_unsatisfied_goals = unsatisfiedGoalsAfter(task, state, op, unsatisfied_goals);
+                }
+                statistics.generated++;
+                int neighbour_h = evaluate(neighbour, neighbour_unsatisfied_goals);
+                if (neighbour_h < 0)
+                    continue;
+                auto writer = successor_writers.find(neighbour_h);
+                if (writer == successor_writers.end())
+                {
+                    writer = successor_writers.emplace(neighbour_h, ofstream(bucketFile(g + 1, neighbour_h, "open"), ios::app)).first;
+                    open_buckets.insert(make_pair(g + 1, neighbour_h));
+                }
+                writer->second << stateToString(packState(task, neighbour)) << '\t' << record.state << '\t' << op << '\n';
+            }
+        }
+    }
+    searchLog() << "States Expanded " << closed_states << endl;
+
+    list<GroundedAction> actions;
+    if (!found && !stopped)
+    {
+        statistics.status = SEARCH_UNSOLVABLE;
+        searchLog() << "No Plan Found" << endl;
+    }
+    if (found)
+    {
+        statistics.status = SEARCH_SOLVED;
+        searchLog() << "Path Found" << endl;
+        searchLog() << "Backtracking" << endl;
+        ScopedTimer backtrack_timer(statistics.backtrack_time);
+        ExternalRecord record = goal_record;
+        for (int g = goal_g; g > 0; g--)
+        {
+            actions.push_front(getGroundedAction(task, stoi(record.action)));
+            bool parent_found = false;
+            for (const pair<const int, vector<pair<int, string>>> &closed : closed_buckets)
+            {
+                for (const pair<int, string> &file : closed.second)
+                {
+                    if (file.first != g - 1)
+                        continue;
+                    ifstream in(file.second);
+                    string line;
+                    while (!parent_found && getline(in, line))
+                    {
+                        if (externalRecordKey(line) == record.parent)
+                        {
+                            record = parseExternalRecord(line);
+                            parent_found = true;
+                        }
+                    }
+                }
+            }
+            if (!parent_found)
+                throw runtime_error("External search lost the parent of a plan state");
+        }
+    }
+
+    for (const pair<int, int> &bucket : open_buckets)
+        remove(bucketFile(bucket.first, bucket.second, "open").c_str());
+    for (const string &file : scratch_files)
+        remove(file.c_str());
+    rmdir(directory.c_str());
+    return actions;
+}
+
+// Bytes a packed state costs as a hash set entry: the string, the node links and the
+// cached hash, plus its bucket pointer.
+size_t hashEntryBytes(const PackedState &state)
+{
+    return stateBytes(state) + 3 * sizeof(void *) + sizeof(size_t);
+}
+
+list<GroundedAction> extractPlan(const Task &task, const vector<int> &operators)
+{
+    list<GroundedAction> actions;
+    for (int op : operators)
+        actions.push_back(getGroundedAction(task, op));
+    return actions;
+}
+
+// Beam search: breadth-first by layers, keeping only the `beam_width` new successors with
+// the lowest heuristic value in each layer. Kept nodes are recorded as parent links; when
+// links and the duplicate set together exceed the memory budget the duplicate set is
+// dropped first, and the search gives up only when the links alone no longer fit.
+list<GroundedAction> beamSearch(const Task &task, int heuristic)
+{
+    struct BeamLink
+    {
+        int parent;
+        int action;
+    };
+    struct BeamCandidate
+    {
+        double h;
+        int parent;
+        int action;
+        int unsatisfied_goals;
+        State state;
+        PackedState packed;
+    };
+    struct BeamEntry
+    {
+        int link;
+        int unsatisfied_goals;
+        double h;
+        State state;
+    };
+
+    vector<BeamLink> links = {BeamLink{-1, -1}};
+    packed_state_set closed_list;
+    size_t closed_bytes = 0;
+    bool duplicate_detection = true;
+    PackedState start_packed = packState(task, task.initial_state);
+    closed_list.insert(start_packed);
+    closed_bytes += hashEntryBytes(start_packed);
+    int start_unsatisfied_goals = countUnsatisfiedGoals(task, task.initial_state);
+    vector<BeamEntry> layer = {BeamEntry{0, start_unsatisfied_goals, evaluateHeuristic(task, task.initial_state, start_unsatisfied_goals, heuristic), task.initial_state}};
+    int depth = 0;
+    int goal_link = -1;
+    vector<int> applicable;
+    bool stopped = false;
+    SearchMonitor monitor;
+    while (!layer.empty() && goal_link < 0 && !stopped)
+    {
+        vector<BeamCandidate> candidates;
+        for (const BeamEntry &entry : layer)
+        {
+            if (entry.unsatisfied_goals == 0)
+            {
+                goal_link = entry.link;
+                break;
+            }
+            stopped = monitor.stop(depth + entry.h, entry.h);
+            if (stopped)
+                break;
+            statistics.expanded++;
+            {
+                ScopedTimer timer(statistics.successor_time);
+                applicableOperators(task, entry.state, applicable);
+            }
+            for (int op : applicable)
+            {
+                BeamCandidate candidate;
+                {
+                    ScopedTimer timer(statistics.successor_time);
+                    candidate.state = applyAction(task, entry.state, op);
+                    candidate.unsatisfied_goals = unsatisfiedGoalsAfter(task, entry.state, op, entry.unsatisfied_goals);
+                }
+                statistics.generated++;
+                {
+                    ScopedTimer timer(statistics.hashing_time);
+                    candidate.packed = packState(task, candidate.state);
+                    if (duplicate_detection && closed_list.find(candidate.packed) != closed_list.end())
+                        continue;
+                }
+                candidate.h = evaluateHeuristic(task, candidate.state, candidate.unsatisfied_goals, heuristic);
+                if (isinf(candidate.h))
+                    continue;
+                candidate.parent = entry.link;
+                candidate.action = op;
+                candidates.push_back(candidate);
+            }
+        }
+        if (goal_link >= 0 || stopped)
+            break;
+
+        stable_sort(candidates.begin(), candidates.end(), [](const BeamCandidate &a, const BeamCandidate &b)
+                    { return a.h < b.h; });
+        vector<BeamEntry> next_layer;
+        unordered_set<PackedState> in_layer;
+        for (const BeamCandidate &candidate : candidates)
+        {
+            if (next_layer.size() >= options.beam_width)
+                break;
+            if (!in_layer.insert(candidate.packed).second)
+                continue;
+            if (duplicate_detection)
+            {
+                closed_list.insert(candidate.packed);
+                closed_bytes += hashEntryBytes(candidate.packed);
+            }
+            links.push_back(BeamLink{candidate.parent, candidate.action});
+            next_layer.push_back(BeamEntry{(int)links.size() - 1, candidate.unsatisfied_goals, candidate.h, candidate.state});
+        }
+        layer.swap(next_layer);
+        depth++;
+        statistics.open_list_peak = max(statistics.open_list_peak, layer.size());
+
+        size_t layer_bytes = layer.size() * (sizeof(BeamEntry) + task.state_words * sizeof(uint64_t));
+        size_t link_bytes = links.capacity() * sizeof(BeamLink);
+        if (duplicate_detection && link_bytes + layer_bytes + closed_bytes > options.memory_budget)
+        {
+            searchLog() << "Beam search dropped its duplicate set to stay within the memory budget" << endl;
+            closed_list = packed_state_set();
+            closed_bytes = 0;
+            duplicate_detection = false;
+        }
+        if (link_bytes + layer_bytes > options.memory_budget)
+        {
+            searchLog() << "Memory budget exhausted" << endl;
+            statistics.status = SEARCH_LIMIT_REACHED;
+            statistics.limit = "memory budget";
+            break;
+        }
+    }
+    searchLog() << "States Expanded " << statistics.expanded << endl;
+    if (goal_link < 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_FAILED;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    vector<int> operators;
+    for (int link = goal_link; links[link].parent >= 0; link = links[link].parent)
+        operators.push_back(links[link].action);
+    reverse(operators.begin(), operators.end());
+    return extractPlan(task, operators);
+}
+
+// Atom-tuple novelty table for width-based search. Width 1 keeps a bit per atom; width 2
+// also keeps a bit per atom pair (a, b), a < b, in a triangular bit array.
+class NoveltyTable
+{
+private:
+    int width;
+    int atoms;
+    vector<uint64_t> seen_atoms;
+    vector<uint64_t> seen_pairs;
+
+    static bool testAndSet(vector<uint64_t> &bits, size_t index)
+    {
+        uint64_t mask = uint64_t(1) << (index & 63);
+        bool seen = bits[index >> 6] & mask;
+        bits[index >> 6] |= mask;
+        return seen;
+    }
+
+public:
+    NoveltyTable(int atoms, int width) : width(width), atoms(atoms), seen_atoms((atoms + 63) / 64),
+                                         seen_pairs(width >= 2 ? ((size_t)atoms * (atoms - 1) / 2 + 63) / 64 : 0) {}
+
+    // Records the tuples of a state that contain an atom of `added` and returns its novelty:
+    // the size of the smallest such tuple seen for the first time, or width + 1. Tuples
+    // without an added atom must already have been recorded with an earlier state, so a
+    // state evaluated against a fresh table passes all its atoms as `added`.
+    int evaluate(const vector<int> &state_atoms, const vector<int> &added)
+    {
+        int novelty = this->width + 1;
+        for (int a : added)
+        {
+            if (!testAndSet(this->seen_atoms, a))
+                novelty = 1;
+        }
+        if (this->width < 2)
+            return novelty;
+        for (int a : added)
+        {
+            for (int b : state_atoms)
+            {
+                if (a == b)
+                    continue;
+                size_t low = min(a, b), high = max(a, b);
+                size_t pair = low * (2 * (size_t)this->atoms - low - 1) / 2 + (high - low - 1);
+                if (!testAndSet(this->seen_pairs, pair))
+                    novelty = min(novelty, 2);
+            }
+        }
+        return novelty;
+    }
+};
+
+void trueAtoms(const State &state, vector<int> &atoms)
+{
+    atoms.clear();
+    for (size_t w = 0; w < state.size(); w++)
+    {
+        for (uint64_t bits = state[w]; bits; bits &= bits - 1)
+            atoms.push_back(w * 64 + __builtin_ctzll(bits));
+    }
+}
+
+// Serialized iterated width (SIW): from the current state, breadth-first searches IW(1),
+// IW(2), ... up to options.width look for a state with fewer unsatisfied goals, and the
+// search continues from the first one found. IW(k) prunes every generated state that makes
+// no atom tuple of size k true for the first time, so it runs in time polynomial in the
+// number of atoms and reaches any single goal of width at most k; being incomplete,
+// running out of novel states is a failure, not a proof that there is no plan.
+list<GroundedAction> iteratedWidthSearch(const Task &task)
+{
+    struct WidthEntry
+    {
+        int link;
+        int unsatisfied_goals;
+        State state;
+    };
+    struct WidthLink
+    {
+        int parent;
+        int action;
+    };
+
+    vector<int> applicable;
+    vector<int> atoms;
+    vector<int> added;
+    vector<WidthLink> links = {WidthLink{-1, -1}};
+    WidthEntry current{0, countUnsatisfiedGoals(task, task.initial_state), task.initial_state};
+    SearchMonitor monitor;
+    bool stopped = false;
+    while (current.unsatisfied_goals > 0 && !stopped)
+    {
+        size_t stage_links = links.size();
+        int goal_link = -1;
+        WidthEntry reached;
+        for (int width = 1; width <= options.width && goal_link < 0 && !stopped; width++)
+        {
+            links.resize(stage_links);
+            NoveltyTable novelty(task.atoms.size(), width);
+            trueAtoms(current.state, atoms);
+            novelty.evaluate(atoms, atoms);
+            deque<WidthEntry> open_list = {current};
+            while (!open_list.empty() && goal_link < 0)
+            {
+                WidthEntry entry = move(open_list.front());
+                open_list.pop_front();
+                stopped = monitor.stop(entry.unsatisfied_goals, entry.unsatisfied_goals);
+                if (stopped)
+                    break;
+                statistics.expanded++;
+                {
+                    ScopedTimer timer(statistics.successor_time);
+                    applicableOperators(task, entry.state, applicable);
+                }
+                for (int op : applicable)
+                {
+                    WidthEntry successor;
+                    {
+                        ScopedTimer timer(statistics.successor_time);
+                        successor.state = applyAction(task, entry.state, op);
+                        successor.unsatisfied_goals = unsatisfiedGoalsAfter(task, entry.state, op, entry.unsatisfied_goals);
+                    }
+                    statistics.generated++;
+                    added.assign(task.operators.add_atoms.begin() + task.operators.add_begin[op],
+                                 task.operators.add_atoms.begin() + task.operators.add_begin[op + 1]);
+                    trueAtoms(successor.state, atoms);
+                    if (novelty.evaluate(atoms, added) > width)
+                        continue;
+                    links.push_back(WidthLink{entry.link, op});
+                    successor.link = links.size() - 1;
+                    if (successor.unsatisfied_goals < current.unsatisfied_goals)
+                    {
+                        goal_link = successor.link;
+                        reached = move(successor);
+                        break;
+                    }
+                    open_list.push_back(move(successor));
+                }
+                statistics.open_list_peak = max(statistics.open_list_peak, open_list.size());
+            }
+        }
+        if (goal_link < 0)
+            break;
+        current = move(reached);
+    }
+    searchLog() << "States Expanded " << statistics.expanded << endl;
+    if (current.unsatisfied_goals > 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_FAILED;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    vector<int> operators;
+    for (int link = current.link; links[link].parent >= 0; link = links[link].parent)
+        operators.push_back(links[link].action);
+    reverse(operators.begin(), operators.end());
+    return extractPlan(task, operators);
+}
+
+// Best-first width search BFWS(w_h, h): expands states by their novelty among the
+// generated states with the same heuristic value (atoms and atom pairs), then by that
+// value. With heuristic 1 the partitions are the goal counts of BFWS(f5). It prunes only
+// duplicates and dead ends, so it is complete, unlike IW.
+list<GroundedAction> bestFirstWidthSearch(const Task &task, int heuristic)
+{
+    struct WidthNode
+    {
+        int novelty;
+        double h;
+        int g;
+        int link;
+        int unsatisfied_goals;
+        State state;
+    };
+    struct CompareWidthNode
+    {
+        bool operator()(const WidthNode &a, const WidthNode &b) const
+        {
+            return make_tuple(a.novelty, a.h, a.g) > make_tuple(b.novelty, b.h, b.g);
+        }
+    };
+    struct WidthLink
+    {
+        int parent;
+        int action;
+    };
+
+    map<double, NoveltyTable> partitions;
+    auto novelty = [&](double h, const vector<int> &atoms)
+    {
+        auto partition = partitions.find(h);
+        if (partition == partitions.end())
+            partition = partitions.emplace(h, NoveltyTable(task.atoms.size(), 2)).first;
+        return partition->second.evaluate(atoms, atoms);
+    };
+
+    vector<WidthLink> links = {WidthLink{-1, -1}};
+    packed_state_set closed_list;
+    priority_queue<WidthNode, vector<WidthNode>, CompareWidthNode> open_list;
+    vector<int> atoms;
+    vector<int> applicable;
+    int start_unsatisfied_goals = countUnsatisfiedGoals(task, task.initial_state);
+    double start_h = evaluateHeuristic(task, task.initial_state, start_unsatisfied_goals, heuristic);
+    trueAtoms(task.initial_state, atoms);
+    open_list.push(WidthNode{novelty(start_h, atoms), start_h, 0, 0, start_unsatisfied_goals, task.initial_state});
+    closed_list.insert(packState(task, task.initial_state));
+    int goal_link = -1;
+    SearchMonitor monitor;
+    while (!open_list.empty())
+    {
+        WidthNode node = open_list.top();
+        open_list.pop();
+        if (node.unsatisfied_goals == 0)
+        {
+            goal_link = node.link;
+            break;
+        }
+        if (monitor.stop(node.g + node.h, node.h))
+            break;
+        statistics.expanded++;
+        {
+            ScopedTimer timer(statistics.successor_time);
+            applicableOperators(task, node.state, applicable);
+        }
+        for (int op : applicable)
+        {
+            WidthNode successor;
+            {
+                ScopedTimer timer(statistics.successor_time);
+                successor.state = applyAction(task, node.state, op);
+                successor.unsatisfied_goals = unsatisfiedGoalsAfter(task, node.state, op, node.unsatisfied_goals);
+            }
+            statistics.generated++;
+            {
+                ScopedTimer timer(statistics.hashing_time);
+                if (!closed_list.insert(packState(task, successor.state)).second)
+                    continue;
+            }
+            successor.h = evaluateHeuristic(task, successor.state, successor.unsatisfied_goals, heuristic);
+            if (isinf(successor.h))
+                continue;
+            trueAtoms(successor.state, atoms);
+            successor.novelty = novelty(successor.h, atoms);
+            successor.g = node.g + 1;
+            links.push_back(WidthLink{node.link, op});
+            successor.link = links.size() - 1;
+            open_list.push(move(successor));
+        }
+        statistics.open_list_peak = max(statistics.open_list_peak, open_list.size());
+    }
+    searchLog() << "States Expanded " << statistics.expanded << endl;
+    if (goal_link < 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_UNSOLVABLE;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    vector<int> operators;
+    for (int link = goal_link; links[link].parent >= 0; link = links[link].parent)
+        operators.push_back(links[link].action);
+    reverse(operators.begin(), operators.end());
+    return extractPlan(task, operators);
+}
+
+// Removes the loops of a plan: whenever a state recurs, the operators between its two
+// occurrences are dropped.
+vector<int> removePlanLoops(const Task &task, const vector<int> &operators)
+{
+    vector<int> plan;
+    unordered_map<PackedState, int> visited; // state -> number of plan operators before it
+    vector<PackedState> states = {packState(task, task.initial_state)};
+    visited[states[0]] = 0;
+    State state = task.initial_state;
+    for (int op : operators)
+    {
+        state = applyAction(task, state, op);
+        PackedState packed = packState(task, state);
+        auto earlier = visited.find(packed);
+        if (earlier == visited.end())
+        {
+            plan.push_back(op);
+            states.push_back(packed);
+            visited[packed] = plan.size();
+            continue;
+        }
+        for (size_t i = earlier->second + 1; i < states.size(); i++)
+            visited.erase(states[i]);
+        plan.resize(earlier->second);
+        states.resize(earlier->second + 1);
+    }
+    return plan;
+}
+
+// Monte Carlo random-walk search in the style of Arvand. Each step runs options.walks
+// random walks of bounded length from the current state, spread over threads, and jumps
+// to the endpoint with the lowest heuristic value. Steps that do not improve on the best
+// value since the last restart lengthen the walks, and after seven of them the search
+// restarts from the initial state. Memory use is the walks and the jump sequence, however
+// many states are visited. Incomplete: gives up after options.walk_restarts restarts.
+list<GroundedAction> randomWalkSearch(const Task &task, int heuristic)
+{
+    struct WalkEndpoint
+    {
+        bool goal = false;
+        double h = numeric_limits<double>::infinity();
+        int unsatisfied_goals = 0;
+        State state;
+        vector<int> actions;
+    };
+    // What a walker counted in its own thread_local statistics.
+    struct WalkCounters
+    {
+        long steps = 0;
+        double heuristic_time = 0;
+        long dead_ends = 0;
+        long heuristic_cache_hits = 0;
+        long heuristic_cache_misses = 0;
+    };
+    const int stagnation_limit = 7;
+    const double length_growth = 1.5;
+    int threads = options.walk_threads > 0 ? options.walk_threads : max(1u, thread::hardware_concurrency());
+
+    State current = task.initial_state;
+    int current_unsatisfied_goals = countUnsatisfiedGoals(task, current);
+    double current_h = evaluateHeuristic(task, current, current_unsatisfied_goals, heuristic);
+    double best_h = current_h;
+    vector<int> prefix; // jumps from the initial state to `current`
+    double length = options.walk_length;
+    int stagnant_steps = 0;
+    int restarts = 0;
+    uint64_t step = 0;
+    SearchMonitor monitor;
+    while (current_unsatisfied_goals > 0)
+    {
+        if (monitor.stop(prefix.size() + current_h, current_h))
+            break;
+        vector<WalkEndpoint> endpoints(threads);
+        vector<WalkCounters> counters(threads);
+        auto walk = [&](int t)
+        {
+            mt19937_64 random(step * threads + t);
+            vector<int> applicable;
+            vector<int> actions;
+            WalkEndpoint &best = endpoints[t];
+            for (int w = t; w < options.walks && !best.goal && !search_cancelled && !timeLimitReached(); w += threads)
+            {
+                State state = current;
+                int unsatisfied_goals = current_unsatisfied_goals;
+                actions.clear();
+                for (int i = 0; i < (int)length && unsatisfied_goals > 0; i++)
+                {
+                    applicableOperators(task, state, applicable);
+                    if (applicable.empty())
+                        break;
+                    int op = applicable[random() % applicable.size()];
+                    unsatisfied_goals = unsatisfiedGoalsAfter(task, state, op, unsatisfied_goals);
+                    state = applyAction(task, state, op);
+                    actions.push_back(op);
+                    counters[t].steps++;
+                }
+                bool goal = unsatisfied_goals == 0;
+                double h = evaluateHeuristic(task, state, unsatisfied_goals, heuristic);
+                if (isinf(h) || actions.empty() || make_pair(!goal, h) >= make_pair(!best.goal, best.h))
+                    continue;
+                best.goal = goal;
+                best.h = h;
+                best.unsatisfied_goals = unsatisfied_goals;
+                best.state = state;
+                best.actions = actions;
+            }
+            // The main thread's walker already counts into the reported statistics.
+            if (t > 0)
+            {
+                counters[t].heuristic_time = statistics.heuristic_time;
+                counters[t].dead_ends = statistics.dead_ends;
+                counters[t].heuristic_cache_hits = statistics.heuristic_cache_hits;
+                counters[t].heuristic_cache_misses = statistics.heuristic_cache_misses;
+            }
+        };
+        vector<thread> workers;
+        for (int t = 1; t < threads; t++)
+            workers.emplace_back(walk, t);
+        walk(0);
+        for (thread &worker : workers)
+            worker.join();
+        step++;
+        for (const WalkCounters &walker : counters)
+        {
+            statistics.expanded += walker.steps;
+            statistics.generated += walker.steps;
+            statistics.heuristic_time += walker.heuristic_time;
+            statistics.dead_ends += walker.dead_ends;
+            statistics.heuristic_cache_hits += walker.heuristic_cache_hits;
+            statistics.heuristic_cache_misses += walker.heuristic_cache_misses;
+        }
+
+        WalkEndpoint *best = nullptr;
+        for (WalkEndpoint &endpoint : endpoints)
+        {
+            if (!isinf(endpoint.h) && (best == nullptr || make_pair(!endpoint.goal, endpoint.h) < make_pair(!best->goal, best->h)))
+                best = &endpoint;
+        }
+        if (best != nullptr)
+        {
+            current = move(best->state);
+            current_unsatisfied_goals = best->unsatisfied_goals;
+            current_h = best->h;
+            prefix.insert(prefix.end(), best->actions.begin(), best->actions.end());
+            if (current_h < best_h)
+            {
+                best_h = current_h;
+                stagnant_steps = 0;
+                length = options.walk_length;
+                continue;
+            }
+            length *= length_growth;
+        }
+        if (best != nullptr && ++stagnant_steps < stagnation_limit)
+            continue;
+        if (++restarts > options.walk_restarts)
+            break;
+        current = task.initial_state;
+        current_unsatisfied_goals = countUnsatisfiedGoals(task, current);
+        current_h = best_h = evaluateHeuristic(task, current, current_unsatisfied_goals, heuristic);
+        prefix.clear();
+        length = options.walk_length;
+        stagnant_steps = 0;
+    }
+    searchLog() << "Random Walk Steps " << statistics.expanded << " (" << step << " jumps, " << restarts << " restarts)" << endl;
+    if (current_unsatisfied_goals > 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_FAILED;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    return extractPlan(task, removePlanLoops(task, prefix));
+}
+
+// SMA*-style memory-bounded best-first search over a search tree. Nodes are kept ordered
+// by (f, depth); the best one is expanded completely and its f value, and those of its
+// ancestors, are backed up from their children. When the nodes in memory exceed the budget
+// the worst leaf (highest f, shallowest) is evicted and its f value is remembered by its
+// parent, which goes back on the open list with that f and regenerates the missing
+// children if it turns out to be promising again.
+list<GroundedAction> smaStarSearch(const Task &task, int heuristic)
+{
+    struct SmaNode
+    {
+        PackedState state;
+        double g;
+        double f;
+        double forgotten_f; // lowest f among evicted children
+        int parent;
+        int action;
+        int depth;
+        vector<int> children;
+    };
+    typedef tuple<double, int, int> OpenEntry; // (f, -depth, node)
+
+    const double infinity = numeric_limits<double>::infinity();
+    // A deque never moves its nodes, so it grows in small blocks instead of doubling.
+    deque<SmaNode> nodes;
+    vector<int> free_nodes;
+    set<OpenEntry> open_list;      // leaves
+    set<OpenEntry> forgotten_list; // expanded nodes with forgotten children
+    size_t payload_bytes = 0; // heap memory owned by live nodes
+    const size_t allocation_overhead = 2 * sizeof(void *); // malloc bookkeeping per block
+    auto heapBytes = [&](const SmaNode &node)
+    {
+        size_t state = stateBytes(node.state) - sizeof(PackedState);
+        size_t children = node.children.capacity() * sizeof(int);
+        return state + children + (state > 0 ? allocation_overhead : 0) + (children > 0 ? allocation_overhead : 0);
+    };
+    auto memoryUsed = [&]()
+    {
+        return payload_bytes + nodes.size() * sizeof(SmaNode) + free_nodes.capacity() * sizeof(int) +
+               (open_list.size() + forgotten_list.size()) * (sizeof(OpenEntry) + 4 * sizeof(void *) + allocation_overhead);
+    };
+    auto newNode = [&](const SmaNode &node)
+    {
+        int id;
+        if (free_nodes.empty())
+        {
+            id = nodes.size();
+            nodes.push_back(node);
+        }
+        else
+        {
+            id = free_nodes.back();
+            free_nodes.pop_back();
+            nodes[id] = node;
+        }
+        payload_bytes += heapBytes(node);
+        return id;
+    };
+    // A leaf is ordered by its f, an expanded node by the lowest f among its forgotten children.
+    auto openEntry = [&](int id)
+    {
+        return OpenEntry(nodes[id].children.empty() ? nodes[id].f : nodes[id].forgotten_f, -nodes[id].depth, id);
+    };
+    auto unlist = [&](int id)
+    {
+        (nodes[id].children.empty() ? open_list : forgotten_list).erase(openEntry(id));
+    };
+    auto relist = [&](int id)
+    {
+        if (nodes[id].children.empty())
+            open_list.insert(openEntry(id));
+        else if (nodes[id].forgotten_f < infinity)
+            forgotten_list.insert(openEntry(id));
+    };
+    // Recomputes f of `id` and its ancestors from their children after a change below them.
+    auto backUp = [&](int id)
+    {
+        while (id >= 0 && !nodes[id].children.empty())
+        {
+            double f = nodes[id].forgotten_f;
+            for (int child : nodes[id].children)
+                f = min(f, nodes[child].f);
+            if (f == nodes[id].f)
+                break;
+            nodes[id].f = f;
+            id = nodes[id].parent;
+        }
+    };
+    // Removes leaf `id`; its parent is listed (again) with the forgotten f.
+    auto removeLeaf = [&](int id)
+    {
+        unlist(id);
+        payload_bytes -= heapBytes(nodes[id]);
+        int parent = nodes[id].parent;
+        if (parent >= 0)
+        {
+            unlist(parent);
+            vector<int> &siblings = nodes[parent].children;
+            siblings.erase(find(siblings.begin(), siblings.end(), id));
+            nodes[parent].forgotten_f = min(nodes[parent].forgotten_f, nodes[id].f);
+            if (siblings.empty())
+            {
+                nodes[parent].f = nodes[parent].forgotten_f;
+                backUp(nodes[parent].parent);
+            }
+            relist(parent);
+        }
+        nodes[id] = SmaNode();
+        free_nodes.push_back(id);
+    };
+
+    int start_unsatisfied_goals = countUnsatisfiedGoals(task, task.initial_state);
+    int root = newNode(SmaNode{packState(task, task.initial_state), 0, evaluateHeuristic(task, task.initial_state, start_unsatisfied_goals, heuristic), infinity, -1, -1, 0, {}});
+    open_list.insert(openEntry(root));
+    int goal = -1;
+    bool budget_exhausted = false;
+    vector<int> applicable;
+    SearchMonitor monitor;
+    while (!open_list.empty() || !forgotten_list.empty())
+    {
+        OpenEntry best = forgotten_list.empty() || (!open_list.empty() && *open_list.begin() < *forgotten_list.begin())
+                             ? *open_list.begin()
+                             : *forgotten_list.begin();
+        int id = get<2>(best);
+        if (get<0>(best) == infinity)
+            break;
+        State state = unpackState(task, nodes[id].state);
+        int unsatisfied_goals = countUnsatisfiedGoals(task, state);
+        if (unsatisfied_goals == 0)
+        {
+            goal = id;
+            break;
+        }
+        if (monitor.stop(get<0>(best), get<0>(best) - nodes[id].g))
+            break;
+        statistics.expanded++;
+        {
+            ScopedTimer timer(statistics.successor_time);
+            applicableOperators(task, state, applicable);
+        }
+        // Every forgotten child has an f of at least the entry's, which bounds the new ones.
+        double bound = get<0>(best);
+        vector<SmaNode> successors;
+        for (int op : applicable)
+        {
+            State neighbour;
+            int neighbour_unsatisfied_goals;
+            {
+                ScopedTimer timer(statistics.successor_time);
+                neighbour = applyAction(task, state, op);
+                neighbour_unsatisfied_goals = unsatisfiedGoalsAfter(task, state, op, unsatisfied_goals);
+            }
+            statistics.generated++;
+            PackedState packed = packState(task, neighbour);
+            bool known = false;
+            {
+                ScopedTimer timer(statistics.hashing_time);
+                for (int child : nodes[id].children)
+                    known = known || nodes[child].action == op;
+                for (int ancestor = id; ancestor >= 0 && !known; ancestor = nodes[ancestor].parent)
+                    known = nodes[ancestor].state == packed;
+            }
+            if (known)
+                continue;
+            double g = nodes[id].g + 1;
+            double f = max(bound, g + evaluateHeuristic(task, neighbour, neighbour_unsatisfied_goals, heuristic));
+            successors.push_back(SmaNode{packed, g, f, infinity, id, op, nodes[id].depth + 1, {}});
+        }
+
+        unlist(id);
+        nodes[id].forgotten_f = infinity;
+        if (successors.empty() && nodes[id].children.empty())
+        {
+            nodes[id].f = infinity;
+            relist(id);
+            if (nodes[id].parent >= 0)
+                removeLeaf(id);
+            continue;
+        }
+        payload_bytes -= heapBytes(nodes[id]);
+        for (const SmaNode &successor : successors)
+        {
+            int child = newNode(successor);
+            nodes[id].children.push_back(child);
+            open_list.insert(openEntry(child));
+        }
+        payload_bytes += heapBytes(nodes[id]);
+        backUp(id);
+        statistics.open_list_peak = max(statistics.open_list_peak, open_list.size() + forgotten_list.size());
+
+        while (memoryUsed() > options.memory_budget)
+        {
+            if (open_list.size() <= 1)
+            {
+                budget_exhausted = true;
+                statistics.status = SEARCH_LIMIT_REACHED;
+                statistics.limit = "memory budget";
+                break;
+            }
+            removeLeaf(get<2>(*open_list.rbegin()));
+        }
+        if (budget_exhausted)
+            break;
+    }
+    searchLog() << "States Expanded " << statistics.expanded << endl;
+    if (goal < 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_UNSOLVABLE;
+        searchLog() << (budget_exhausted ? "Memory budget exhausted" : "No Plan Found") << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    vector<int> operators;
+    for (int id = goal; nodes[id].parent >= 0; id = nodes[id].parent)
+        operators.push_back(nodes[id].action);
+    reverse(operators.begin(), operators.end());
+    return extractPlan(task, operators);
+}
+
+// Self-contained CDCL SAT solver: two watched literals, first-UIP clause learning with
+// local minimization, VSIDS branching with phase saving, Luby restarts and periodic
+// removal of learnt clauses with a high literal block distance. Variables are numbered
+// from 0; literal 2 * v is v and 2 * v + 1 is its negation.
+class SatSolver
+{
+public:
+    enum Result
+    {
+        SATISFIABLE,
+        UNSATISFIABLE,
+        INTERRUPTED
+    };
+
+    long conflicts = 0;
+    long decisions = 0;
+
+private:
+    struct Clause
+    {
+        vector<int> literals;
+        bool learnt;
+        bool deleted;
+        int lbd;
+    };
+
+    vector<Clause> clauses;
+    vector<vector<int>> watches; // literal -> clauses watching it as literals[0] or [1]
+    vector<signed char> assigns; // per variable: -1 unassigned, 0 false, 1 true
+    vector<int> level;
+    vector<int> reason; // clause that implied the variable, -1 for decisions
+    vector<char> polarity; // saved phase: 1 if last assigned false
+    vector<char> seen;
+    vector<int> trail;
+    vector<int> trail_limits;
+    size_t propagated = 0;
+    bool inconsistent = false;
+    long learnt_clauses = 0;
+    long max_learnt_clauses = 4000;
+
+    vector<double> activity;
+    double activity_increment = 1;
+    vector<int> heap; // variables ordered by activity
+    vector<int> heap_index; // position in heap, -1 if not in it
+
+    static int variable(int literal)
+    {
+        return literal >> 1;
+    }
+
+    // 1 true, 0 false, -1 unassigned
+    int value(int literal) const
+    {
+        signed char assign = this->assigns[variable(literal)];
+        return assign < 0 ? -1 : assign ^ (literal & 1);
+    }
+
+    int decisionLevel() const
+    {
+        return this->trail_limits.size();
+    }
+
+    bool heapLess(int a, int b) const
+    {
+        return this->activity[a] > this->activity[b];
+    }
+
+    void heapUp(int i)
+    {
+        int var = this->heap[i];
+        while (i > 0 && heapLess(var, this->heap[(i - 1) / 2]))
+        {
+            this->heap[i] = this->heap[(i - 1) / 2];
+            this->heap_index[this->heap[i]] = i;
+            i = (i - 1) / 2;
+        }
+        this->heap[i] = var;
+        this->heap_index[var] = i;
+    }
+
+    void heapDown(int i)
+    {
+        int var = this->heap[i];
+        int size = this->heap.size();
+        while (2 * i + 1 < size)
+        {
+            int child = 2 * i + 1;
+            if (child + 1 < size && heapLess(this->heap[child + 1], this->heap[child]))
+                child++;
+            if (!heapLess(this->heap[child], var))
+                break;
+            this->heap[i] = this->heap[child];
+            this->heap_index[this->heap[i]] = i;
+            i = child;
+        }
+        this->heap[i] = var;
+        this->heap_index[var] = i;
+    }
+
+    void heapInsert(int var)
+    {
+        if (this->heap_index[var] >= 0)
+            return;
+        this->heap.push_back(var);
+        heapUp(this->heap.size() - 1);
+    }
+
+    int heapPop()
+    {
+        int var = this->heap[0];
+        this->heap_index[var] = -1;
+        this->heap[0] = this->heap.back();
+        this->heap.pop_back();
+        if (!this->heap.empty())
+        {
+            this->heap_index[this->heap[0]] = 0;
+            heapDown(0);
+        }
+        return var;
+    }
+
+    void bumpActivity(int var)
+    {
+        if ((this->activity[var] += this->activity_increment) > 1e100)
+        {
+            for (double &a : this->activity)
+                a *= 1e-100;
+            this->activity_increment *= 1e-100;
+        }
+        if (this->heap_index[var] >= 0)
+            heapUp(this->heap_index[var]);
+    }
+
+    void enqueue(int literal, int from)
+    {
+        int var = variable(literal);
+        this->assigns[var] = !(literal & 1);
+        this->level[var] = decisionLevel();
+        this->reason[var] = from;
+        this->trail.push_back(literal);
+    }
+
+    void watch(int clause)
+    {
+        const vector<int> &literals = this->clauses[clause].literals;
+        this->watches[literals[0]].push_back(clause);
+        this->watches[literals[1]].push_back(clause);
+    }
+
+    // Returns a conflicting clause, or -1.
+    int propagate()
+    {
+        while (this->propagated < this->trail.size())
+        {
+            int false_literal = this->trail[this->propagated++] ^ 1;
+            vector<int> &watching = this->watches[false_literal];
+            size_t kept = 0;
+            for (size_t i = 0; i < watching.size(); i++)
+            {
+                int clause = watching[i];
+                vector<int> &literals = this->clauses[clause].literals;
+                if (literals[0] == false_literal)
+                    std::swap(literals[0], literals[1]);
+                if (value(literals[0]) == 1)
+                {
+                    watching[kept++] = clause;
+                    continue;
+                }
+                bool moved = false;
+                for (size_t k = 2; k < literals.size() && !moved; k++)
+                {
+                    if (value(literals[k]) != 0)
+                    {
+                        std::swap(literals[1], literals[k]);
+                        this->watches[literals[1]].push_back(clause);
+                        moved = true;
+                    }
+                }
+                if (moved)
+                    continue;
+                watching[kept++] = clause;
+                if (value(literals[0]) == 0)
+                {
+                    for (i++; i < watching.size(); i++)
+                        watching[kept++] = watching[i];
+                    watching.resize(kept);
+                    return clause;
+                }
+                enqueue(literals[0], clause);
+            }
+            watching.resize(kept);
+        }
+        return -1;
+    }
+
+    // First-UIP learnt clause for `conflict`, asserting literal first, then the literal of
+    // the backjump level.
+    vector<int> analyze(int conflict, int &backjump_level)
+    {
+        vector<int> learnt(1);
+        int paths = 0;
+        int literal = -1;
+        int index = this->trail.size() - 1;
+        do
+        {
+            const vector<int> &literals = this->clauses[conflict].literals;
+            for (size_t j = literal < 0 ? 0 : 1; j < literals.size(); j++)
+            {
+                int var = variable(literals[j]);
+                if (this->seen[var] || this->level[var] == 0)
+                    continue;
+                bumpActivity(var);
+                this->seen[var] = 1;
+                if (this->level[var] >= decisionLevel())
+                    paths++;
+                else
+                    learnt.push_back(literals[j]);
+            }
+            while (!this->seen[variable(this->trail[index])])
+                index--;
+            literal = this->trail[index--];
+            conflict = this->reason[variable(literal)];
+            this->seen[variable(literal)] = 0;
+            paths--;
+        } while (paths > 0);
+        learnt[0] = literal ^ 1;
+
+        // Drop literals implied by the others through their reason clause.
+        vector<int> minimized(1, learnt[0]);
+        for (size_t i = 1; i < learnt.size(); i++)
+        {
+            int from = this->reason[variable(learnt[i])];
+            bool redundant = from >= 0;
+            if (redundant)
+            {
+                const vector<int> &literals = this->clauses[from].literals;
+                for (size_t j = 1; j < literals.size() && redundant; j++)
+                {
+                    int var = variable(literals[j]);
+                    redundant = this->seen[var] || this->level[var] == 0;
+                }
+            }
+            if (!redundant)
+                minimized.push_back(learnt[i]);
+        }
+        for (size_t i = 1; i < learnt.size(); i++)
+            this->seen[variable(learnt[i])] = 0;
+
+        backjump_level = 0;
+        for (size_t i = 1; i < minimized.size(); i++)
+        {
+            if (this->level[variable(minimized[i])] > backjump_level)
+            {
+                backjump_level = this->level[variable(minimized[i])];
+                std::swap(minimized[1], minimized[i]);
+            }
+        }
+        return minimized;
+    }
+
+    void backtrack(int target_level)
+    {
+        if (decisionLevel() <= target_level)
+            return;
+        for (size_t i = this->trail.size(); i-- > (size_t)this->trail_limits[target_level];)
+        {
+            int var = variable(this->trail[i]);
+            this->polarity[var] = this->trail[i] & 1;
+            this->assigns[var] = -1;
+            this->reason[var] = -1;
+            heapInsert(var);
+        }
+        this->trail.resize(this->trail_limits[target_level]);
+        this->trail_limits.resize(target_level);
+        this->propagated = this->trail.size();
+    }
+
+    int literalBlockDistance(const vector<int> &literals) const
+    {
+        unordered_set<int> levels;
+        for (int literal : literals)
+            levels.insert(this->level[variable(literal)]);
+        return levels.size();
+    }
+
+    // At decision level 0: forgets the worse half of the learnt clauses (by LBD), keeping
+    // those with LBD 2 or less, and rebuilds the watch lists.
+    void reduceLearntClauses()
+    {
+        vector<int> candidates;
+        for (size_t i = 0; i < this->clauses.size(); i++)
+            if (this->clauses[i].learnt && !this->clauses[i].deleted && this->clauses[i].lbd > 2)
+                candidates.push_back(i);
+        sort(candidates.begin(), candidates.end(), [&](int a, int b)
+             { return this->clauses[a].lbd > this->clauses[b].lbd; });
+        for (size_t i = 0; i < candidates.size() / 2; i++)
+        {
+            Clause &clause = this->clauses[candidates[i]];
+            clause.deleted = true;
+            clause.literals = vector<int>();
+            this->learnt_clauses--;
+        }
+        for (vector<int> &watching : this->watches)
+            watching.clear();
+        for (size_t i = 0; i < this->clauses.size(); i++)
+            if (!this->clauses[i].deleted)
+                watch(i);
+        this->max_learnt_clauses += this->max_learnt_clauses / 10;
+    }
+
+    static long luby(long i)
+    {
+        long size = 1, sequence = 0;
+        while (size < i + 1)
+        {
+            sequence++;
+            size = 2 * size + 1;
+        }
+        while (size - 1 != i)
+        {
+            size = (size - 1) / 2;
+            sequence--;
+            i = i % size;
+        }
+        return 1l << sequence;
+    }
+
+public:
+    int newVariable()
+    {
+        int var = this->assigns.size();
+        this->assigns.push_back(-1);
+        this->level.push_back(0);
+        this->reason.push_back(-1);
+        this->polarity.push_back(1);
+        this->seen.push_back(0);
+        this->activity.push_back(0);
+        this->heap_index.push_back(-1);
+        this->watches.resize(2 * (var + 1));
+        heapInsert(var);
+        return var;
+    }
+
+    int variables() const
+    {
+        return this->assigns.size();
+    }
+
+    size_t clauseCount() const
+    {
+        return this->clauses.size();
+    }
+
+    // Clauses must be added before solve(), at decision level 0.
+    void addClause(vector<int> literals)
+    {
+        if (this->inconsistent)
+            return;
+        sort(literals.begin(), literals.end());
+        literals.erase(unique(literals.begin(), literals.end()), literals.end());
+        vector<int> remaining;
+        for (size_t i = 0; i < literals.size(); i++)
+        {
+            if (i + 1 < literals.size() && literals[i + 1] == (literals[i] ^ 1))
+                return; // tautology
+            int v = value(literals[i]);
+            if (v == 1)
+                return;
+            if (v < 0)
+                remaining.push_back(literals[i]);
+        }
+        if (remaining.empty())
+            this->inconsistent = true;
+        else if (remaining.size() == 1)
+        {
+            enqueue(remaining[0], -1);
+            this->inconsistent = propagate() >= 0;
+        }
+        else
+        {
+            this->clauses.push_back(Clause{remaining, false, false, 0});
+            watch(this->clauses.size() - 1);
+        }
+    }
+
+    // `interrupted` is polled every 256 conflicts.
+    Result solve(const function<bool()> &interrupted)
+    {
+        if (this->inconsistent || propagate() >= 0)
+            return UNSATISFIABLE;
+        long restarts = 0;
+        long restart_conflicts = 100 * luby(restarts);
+        long conflicts_since_restart = 0;
+        while (true)
+        {
+            int conflict = propagate();
+            if (conflict >= 0)
+            {
+                this->conflicts++;
+                conflicts_since_restart++;
+                if (decisionLevel() == 0)
+                    return UNSATISFIABLE;
+                int backjump_level;
+                vector<int> learnt = analyze(conflict, backjump_level);
+                backtrack(backjump_level);
+                if (learnt.size() == 1)
+                    enqueue(learnt[0], -1);
+                else
+                {
+                    int lbd = literalBlockDistance(learnt);
+                    this->clauses.push_back(Clause{learnt, true, false, lbd});
+                    watch(this->clauses.size() - 1);
+                    this->learnt_clauses++;
+                    enqueue(learnt[0], this->clauses.size() - 1);
+                }
+                this->activity_increment /= 0.95;
+                if (this->conflicts % 256 == 0 && interrupted())
+                    return INTERRUPTED;
+                continue;
+            }
+            if (conflicts_since_restart >= restart_conflicts)
+            {
+                backtrack(0);
+                restarts++;
+                restart_conflicts = 100 * luby(restarts);
+                conflicts_since_restart = 0;
+                if (this->learnt_clauses > this->max_learnt_clauses)
+                    reduceLearntClauses();
+                continue;
+            }
+            int next = -1;
+            while (next < 0 && !this->heap.empty())
+            {
+                int var = heapPop();
+                if (this->assigns[var] < 0)
+                    next = var;
+            }
+            if (next < 0)
+                return SATISFIABLE;
+            this->decisions++;
+            this->trail_limits.push_back(this->trail.size());
+            enqueue(2 * next + this->polarity[next], -1);
+        }
+    }
+
+    bool modelValue(int var) const
+    {
+        return this->assigns[var] == 1;
+    }
+};
+
+// Planning as satisfiability with the ∀-step parallel encoding: at every step any set of
+// pairwise non-interfering operators may be applied, where o interferes with o' if it
+// deletes a precondition of o' or adds one of its negative preconditions. Explanatory
+// frame axioms tie every atom change to an operator that causes it, and mutex groups
+// become at-most-one clauses per time point. The horizon starts at 1 and grows by
+// --sat-growth until a plan is found or it exceeds --sat-max-horizon.
+list<GroundedAction> satSearch(const Task &task)
+{
+    const OperatorTable &ops = task.operators;
+    int atoms = task.atoms.size();
+    int operators = ops.size();
+    vector<vector<int>> adders(atoms), deleters(atoms), requirers(atoms), negative_requirers(atoms);
+    for (int op = 0; op < operators; op++)
+    {
+        for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+            adders[ops.add_atoms[i]].push_back(op);
+        for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+        {
+            int atom = ops.delete_atoms[i];
+            if (find(ops.add_atoms.begin() + ops.add_begin[op], ops.add_atoms.begin() + ops.add_begin[op + 1], atom) == ops.add_atoms.begin() + ops.add_begin[op + 1])
+                deleters[atom].push_back(op);
+        }
+        for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+            requirers[ops.precondition_atoms[i]].push_back(op);
+        for (int i = ops.negative_begin[op]; i < ops.negative_begin[op + 1]; i++)
+            negative_requirers[ops.negative_atoms[i]].push_back(op);
+    }
+
+    SearchMonitor monitor;
+    int horizon = 1;
+    while (horizon <= options.sat_max_horizon)
+    {
+        SatSolver solver;
+        // atom a at time t is 2 * (t * atoms + a); operator o at step t follows all atoms
+        auto atomLiteral = [&](int atom, int t, bool truth)
+        {
+            return 2 * (t * atoms + atom) + !truth;
+        };
+        auto operatorLiteral = [&](int op, int t, bool truth)
+        {
+            return 2 * ((horizon + 1) * atoms + t * operators + op) + !truth;
+        };
+        for (int var = 0; var < (horizon + 1) * atoms + horizon * operators; var++)
+            solver.newVariable();
+
+        for (int atom = 0; atom < atoms; atom++)
+            solver.addClause({atomLiteral(atom, 0, holds(task.initial_state, atom))});
+        for (int atom : task.goal_atoms)
+            solver.addClause({atomLiteral(atom, horizon, true)});
+        for (int t = 0; t <= horizon; t++)
+            for (const vector<int> &group : task.mutex_groups)
+                for (size_t i = 0; i < group.size(); i++)
+                    for (size_t j = i + 1; j < group.size(); j++)
+                        solver.addClause({atomLiteral(group[i], t, false), atomLiteral(group[j], t, false)});
+        for (int t = 0; t < horizon; t++)
+        {
+            for (int op = 0; op < operators; op++)
+            {
+                for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+                    solver.addClause({operatorLiteral(op, t, false), atomLiteral(ops.precondition_atoms[i], t, true)});
+                for (int i = ops.negative_begin[op]; i < ops.negative_begin[op + 1]; i++)
+                    solver.addClause({operatorLiteral(op, t, false), atomLiteral(ops.negative_atoms[i], t, false)});
+                for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+                    solver.addClause({operatorLiteral(op, t, false), atomLiteral(ops.add_atoms[i], t + 1, true)});
+            }
+            for (int atom = 0; atom < atoms; atom++)
+            {
+                for (int op : deleters[atom])
+                    solver.addClause({operatorLiteral(op, t, false), atomLiteral(atom, t + 1, false)});
+                // frame axioms: a change of the atom needs an operator that causes it
+                vector<int> becomes_true = {atomLiteral(atom, t, true), atomLiteral(atom, t + 1, false)};
+                for (int op : adders[atom])
+                    becomes_true.push_back(operatorLiteral(op, t, true));
+                solver.addClause(becomes_true);
+                vector<int> becomes_false = {atomLiteral(atom, t, false), atomLiteral(atom, t + 1, true)};
+                for (int op : deleters[atom])
+                    becomes_false.push_back(operatorLiteral(op, t, true));
+                solver.addClause(becomes_false);
+                // ∀-step: no operator may disable another one of the same step
+                for (int deleter : deleters[atom])
+                    for (int requirer : requirers[atom])
+                        if (deleter != requirer)
+                            solver.addClause({operatorLiteral(deleter, t, false), operatorLiteral(requirer, t, false)});
+                for (int adder : adders[atom])
+                    for (int requirer : negative_requirers[atom])
+                        if (adder != requirer)
+                            solver.addClause({operatorLiteral(adder, t, false), operatorLiteral(requirer, t, false)});
+            }
+        }
+
+        SatSolver::Result result = solver.solve([&]()
+                                                { return monitor.stop(horizon, 0); });
+        statistics.sat_conflicts += solver.conflicts;
+        statistics.sat_decisions += solver.decisions;
+        searchLog() << "SAT Horizon " << horizon << ": " << solver.variables() << " variables, " << solver.clauseCount()
+                    << " clauses, " << solver.conflicts << " conflicts, "
+                    << (result == SatSolver::SATISFIABLE ? "satisfiable" : result == SatSolver::UNSATISFIABLE ? "unsatisfiable" : "interrupted") << endl;
+        if (result == SatSolver::INTERRUPTED || (result == SatSolver::UNSATISFIABLE && monitor.stop(horizon, 0)))
+            break;
+        if (result == SatSolver::UNSATISFIABLE)
+        {
+            horizon = max(horizon + 1, (int)ceil(horizon * options.sat_horizon_growth));
+            continue;
+        }
+
+        // Any order of a ∀-step step is valid; replaying the plan checks the decoding.
+        vector<int> plan;
+        State state = task.initial_state;
+        bool decoded = true;
+        for (int t = 0; t < horizon && decoded; t++)
+        {
+            for (int op = 0; op < operators && decoded; op++)
+            {
+                if (!solver.modelValue(operatorLiteral(op, t, true) >> 1))
+                    continue;
+                decoded = checkPreconditions(task, state, op);
+                if (decoded)
+                {
+                    state = applyAction(task, state, op);
+                    plan.push_back(op);
+                }
+            }
+        }
+        if (!decoded || countUnsatisfiedGoals(task, state) > 0)
+        {
+            statistics.status = SEARCH_FAILED;
+            searchLog() << "SAT plan decoding failed at horizon " << horizon << endl;
+            return list<GroundedAction>();
+        }
+        statistics.status = SEARCH_SOLVED;
+        searchLog() << "Path Found" << endl;
+        return extractPlan(task, plan);
+    }
+    if (statistics.status == SEARCH_RUNNING)
+        statistics.status = SEARCH_FAILED;
+    searchLog() << "No Plan Found" << endl;
+    return list<GroundedAction>();
+}
+
+list<GroundedAction> aStarSearch(const Task &task, int heuristic)
+{
+    const State &start = task.initial_state;
+    PackedState start_packed = packState(task, start);
+    parent_link_map came_from;
+    int start_unsatisfied_goals = countUnsatisfiedGoals(task, start);
+    Node start_node = Node(start, -1, 0, getHeuristic(start_unsatisfied_goals, heuristic), start_unsatisfied_goals);
+    Node goal_node;
+    Node current_node = start_node;
+    priority_queue<Node, vector<Node>, CompareNode> open_list;
+    packed_state_set closed_list;
+    packed_g_value_map g_value_list;
+    PackedState current_packed;
+    PackedState goal_packed;
+    bool found = false;
+    double edge_cost = 1;
+    long next_sample = 1;
+    SearchMonitor monitor;
+    open_list.push(start_node);
+    g_value_list[start_packed] = start_node.g_value_;
+    while (!open_list.empty())
+    {
+        statistics.open_list_peak = max(statistics.open_list_peak, open_list.size());
+        current_node = open_list.top();
+        open_list.pop();
+        {
+            ScopedTimer timer(statistics.hashing_time);
+            current_packed = packState(task, current_node.state_);
+            // A stale entry: the state was pushed again with a lower g since.
+            if (current_node.g_value_ > g_value_list[current_packed])
+                continue;
+            if (!closed_list.insert(current_packed).second)
+                continue;
+        }
+        if (current_node.unsatisfied_goals_ == 0)
+        {
+            searchLog() << "Path Found" << endl;
+            goal_node = current_node;
+            goal_packed = current_packed;
+            found = true;
+            break;
+        }
+        if (monitor.stop(current_node.f_value_, current_node.f_value_ - current_node.g_value_))
+            break;
+        statistics.expanded++;
+        statistics.state_bytes += stateBytes(current_packed);
+        if (statistics.expanded == next_sample)
+        {
+            statistics.memory_samples.push_back({statistics.expanded, open_list.size(), closed_list.size(), residentMemoryKB()});
+            next_sample *= 2;
+        }
+        expandActionsAndArguments(open_list, g_value_list, closed_list, task, came_from, current_node, current_packed, edge_cost,heuristic);
+    }
+    searchLog() << "States Expanded " << closed_list.size() << endl;
+    if (!found)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_UNSOLVABLE;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Backtracking" << endl;
+    ScopedTimer backtrack_timer(statistics.backtrack_time);
+    list<GroundedAction> actions = backTrack(task, came_from, start_packed, goal_packed);
+    actions.reverse();
+    return actions;
 }
 
-vector<list<string>> getPermuations(vector<string> arguments, int num_arguments)
+// Bloom-filter visited set for bitstate search, as in Spin's bitstate hashing: a state is
+// recorded as `hashes` bits of a fixed-size bit array chosen by double hashing. Memory is
+// fixed however many states are inserted; the price is that a new state whose bits are
+// all set already is taken for visited and omitted.
+class BitstateSet
 {
-    vector<list<string>> permutations;
-    enumerate(arguments, arguments.size(), num_arguments, permutations);
-    return permutations;
-}
+private:
+    vector<uint64_t> bits;
+    size_t bit_count;
+    int hashes;
+    size_t set_bits = 0;
+    size_t stored = 0;
+    double expected_omissions = 0;
 
-bool checkPreconditions(const condition_set &state, const condition_set &precondition)
-{
-    for (const auto &p : precondition)
+    static uint64_t fnv1a(const PackedState &state)
     {
-        if (state.find(p) == state.end())
-            return false;
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (unsigned char byte : state)
+            hash = (hash ^ byte) * 0x100000001b3ull;
+        return hash;
+    }
+
+public:
+    BitstateSet(size_t bytes, int hashes) : bits(max<size_t>(1, bytes / 8)), bit_count(bits.size() * 64), hashes(hashes) {}
+
+    // Returns false when `state` is taken for visited, whether it was or not.
+    bool insert(const PackedState &state)
+    {
+        uint64_t h1 = hash<string>()(state);
+        uint64_t h2 = fnv1a(state) | 1;
+        double omission = this->omissionProbability();
+        bool fresh = false;
+        for (int i = 0; i < this->hashes; i++)
+        {
+            size_t bit = (h1 + i * h2) % this->bit_count;
+            uint64_t mask = uint64_t(1) << (bit & 63);
+            if (this->bits[bit >> 6] & mask)
+                continue;
+            this->bits[bit >> 6] |= mask;
+            this->set_bits++;
+            fresh = true;
+        }
+        if (fresh)
+        {
+            this->stored++;
+            this->expected_omissions += omission;
+        }
+        return fresh;
     }
-    return true;
-}
 
-condition_set applyAction(condition_set &state, condition_set effect)
+    // Probability that the next new state is omitted: that all its bits are set.
+    double omissionProbability() const
+    {
+        return pow((double)this->set_bits / this->bit_count, this->hashes);
+    }
+
+    // Sum of the omission probabilities at each insertion, an estimate of the number of
+    // distinct states the search lost.
+    double expectedOmissions() const
+    {
+        return this->expected_omissions;
+    }
+
+    size_t size() const
+    {
+        return this->stored;
+    }
+
+    size_t bytes() const
+    {
+        return this->bits.size() * sizeof(uint64_t);
+    }
+};
+
+// Best-first search in A* order whose duplicate detection is a BitstateSet of
+// options.bitstate_bytes instead of the exact closed list and g values. States are marked
+// when generated and never reopened, open states are kept packed and parent links are
+// (parent, operator) pairs. Omissions can cost the plan or its optimality, so running out
+// of states is a failure, not a proof that there is no plan.
+list<GroundedAction> bitstateSearch(const Task &task, int heuristic)
 {
-    condition_set new_state = state;
-    for (const auto &e : effect)
+    struct BitstateNode
     {
-        GroundedCondition cond = GroundedCondition(e.get_predicate(), e.get_arg_values());
-        if (!e.get_truth())
-            new_state.erase(cond);
-        else
-            new_state.insert(cond);
+        double f;
+        double h;
+        int link;
+        int unsatisfied_goals;
+        PackedState state;
+    };
+    struct CompareBitstateNode
+    {
+        bool operator()(const BitstateNode &a, const BitstateNode &b) const
+        {
+            return make_pair(a.f, a.h) > make_pair(b.f, b.h);
+        }
+    };
+    struct BitstateLink
+    {
+        int parent;
+        int action;
+        int g;
+    };
+
+    BitstateSet visited(options.bitstate_bytes, options.bitstate_hashes);
+    vector<BitstateLink> links = {BitstateLink{-1, -1, 0}};
+    priority_queue<BitstateNode, vector<BitstateNode>, CompareBitstateNode> open_list;
+    int start_unsatisfied_goals = countUnsatisfiedGoals(task, task.initial_state);
+    double start_h = evaluateHeuristic(task, task.initial_state, start_unsatisfied_goals, heuristic);
+    PackedState start_packed = packState(task, task.initial_state);
+    visited.insert(start_packed);
+    open_list.push(BitstateNode{start_h, start_h, 0, start_unsatisfied_goals, start_packed});
+    vector<int> applicable;
+    int goal_link = -1;
+    SearchMonitor monitor;
+    while (!open_list.empty())
+    {
+        statistics.open_list_peak = max(statistics.open_list_peak, open_list.size());
+        BitstateNode node = open_list.top();
+        open_list.pop();
+        if (node.unsatisfied_goals == 0)
+        {
+            goal_link = node.link;
+            break;
+        }
+        if (monitor.stop(node.f, node.h))
+            break;
+        statistics.expanded++;
+        State state = unpackState(task, node.state);
+        {
+            ScopedTimer timer(statistics.successor_time);
+            applicableOperators(task, state, applicable);
+        }
+        int g = links[node.link].g + 1;
+        for (int op : applicable)
+        {
+            State neighbour;
+            int neighbour_unsatisfied_goals;
+            {
+                ScopedTimer timer(statistics.successor_time);
+                neighbour = applyAction(task, state, op);
+                neighbour_unsatisfied_goals = unsatisfiedGoalsAfter(task, state, op, node.unsatisfied_goals);
+            }
+            statistics.generated++;
+            PackedState packed;
+            {
+                ScopedTimer timer(statistics.hashing_time);
+                packed = packState(task, neighbour);
+                if (!visited.insert(packed))
+                    continue;
+            }
+            double h = evaluateHeuristic(task, neighbour, neighbour_unsatisfied_goals, heuristic);
+            if (isinf(h))
+                continue;
+            links.push_back(BitstateLink{node.link, op, g});
+            open_list.push(BitstateNode{g + h, h, (int)links.size() - 1, neighbour_unsatisfied_goals, packed});
+        }
     }
-    return new_state;
+    statistics.expected_omissions = visited.expectedOmissions();
+    searchLog() << "States Expanded " << statistics.expanded << endl;
+    searchLog() << "Bitstate Set " << visited.size() << " states in " << visited.bytes() << " bytes, "
+                << options.bitstate_hashes << " hashes, omission probability " << visited.omissionProbability()
+                << ", expected omitted states " << visited.expectedOmissions() << endl;
+    if (goal_link < 0)
+    {
+        if (statistics.status == SEARCH_RUNNING)
+            statistics.status = SEARCH_FAILED;
+        searchLog() << "No Plan Found" << endl;
+        return list<GroundedAction>();
+    }
+    statistics.status = SEARCH_SOLVED;
+    searchLog() << "Path Found" << endl;
+    vector<int> operators;
+    for (int link = goal_link; links[link].parent >= 0; link = links[link].parent)
+        operators.push_back(links[link].action);
+    reverse(operators.begin(), operators.end());
+    return extractPlan(task, operators);
 }
 
-condition_set applyActionHeuristic(condition_set &state, condition_set effect)
+list<GroundedAction> runSearch(const Task &task, const string &search, int heuristic)
 {
-    condition_set new_state = state;
-    for (const auto &e : effect)
+    if (search == "external")
+        return externalAStar(task, heuristic);
+    if (search == "beam")
+        return beamSearch(task, heuristic);
+    if (search == "sma")
+        return smaStarSearch(task, heuristic);
+    if (search == "sat")
+        return satSearch(task);
+    if (search == "iw")
     {
-        GroundedCondition cond = GroundedCondition(e.get_predicate(), e.get_arg_values());
-        if (e.get_truth())
-            new_state.insert(cond);
+        // SIW uses no heuristic and is incomplete; once it runs out of novel states the
+        // heuristic goes to a complete BFWS from the initial state.
+        list<GroundedAction> plan = iteratedWidthSearch(task);
+        if (statistics.status != SEARCH_FAILED)
+            return plan;
+        searchLog() << "SIW Failed, Falling Back To BFWS With Heuristic " << heuristic << endl;
+        statistics.status = SEARCH_RUNNING;
+        return bestFirstWidthSearch(task, heuristic);
     }
-    return new_state;
+    if (search == "bfws")
+        return bestFirstWidthSearch(task, heuristic);
+    if (search == "mrw")
+        return randomWalkSearch(task, heuristic);
+    if (search != "astar")
+        throw invalid_argument("Unknown search " + search);
+    if (options.bitstate_bytes > 0)
+        return bitstateSearch(task, heuristic);
+    return aStarSearch(task, heuristic);
 }
 
-GroundedAction getGroundedAction(Action act, list<string> arg)
+// Races the configurations in options.portfolio ("<search>:<heuristic>,...") on one thread
+// each over the shared, read-only task. The first worker to find a plan, or to prove that
+// there is none, raises search_cancelled, which makes the others give up at their next
+// poll; its statistics become the reported search statistics.
+list<GroundedAction> portfolioSearch(const Task &task)
 {
-    unordered_set<GroundedCondition, GroundedConditionHasher, GroundedConditionComparator> preconditions;
-    unordered_set<GroundedCondition, GroundedConditionHasher, GroundedConditionComparator> effects;
-    list<string> action_arguments = act.get_args();
-    for (const Condition cond : act.get_preconditions())
+    vector<pair<string, int>> configurations;
+    stringstream portfolio(options.portfolio);
+    string configuration;
+    while (getline(portfolio, configuration, ','))
+    {
+        size_t colon = configuration.find(':');
+        if (colon == string::npos)
+            throw invalid_argument("Portfolio entry " + configuration + " is not <search>:<heuristic>");
+        configurations.push_back(make_pair(configuration.substr(0, colon), stoi(configuration.substr(colon + 1))));
+    }
+    if (configurations.empty())
+        throw invalid_argument("Empty portfolio");
+
+    mutex winner_mutex;
+    int winner = -1;
+    list<GroundedAction> winner_plan;
+    PlannerStatistics winner_statistics;
+    vector<exception_ptr> errors(configurations.size());
+    vector<PlannerStatistics> worker_statistics(configurations.size());
+    search_cancelled = false;
+    vector<thread> workers;
+    for (size_t i = 0; i < configurations.size(); i++)
     {
-        list<string> condition_arguments = cond.get_args();
-        list<string> grounded_condition_arguments = condition_arguments;
-        for (int i = 0; i < condition_arguments.size(); i++)
+        auto work = [&, i]()
         {
-            for (int j = 0; j < action_arguments.size(); j++)
+            search_output = false;
+            try
             {
-                if (*std::next(condition_arguments.begin(), i) == *std::next(action_arguments.begin(), j))
-                {
-                    *std::next(grounded_condition_arguments.begin(), i) = *std::next(arg.begin(), j);
-                }
+                list<GroundedAction> plan = runSearch(task, configurations[i].first, configurations[i].second);
+                worker_statistics[i] = statistics;
+                if (statistics.status != SEARCH_SOLVED && statistics.status != SEARCH_UNSOLVABLE)
+                    return;
+                lock_guard<mutex> lock(winner_mutex);
+                if (winner >= 0)
+                    return;
+                winner = i;
+                winner_plan = plan;
+                winner_statistics = statistics;
+                search_cancelled = true;
             }
-        }
-        preconditions.insert(GroundedCondition(cond.get_predicate(), grounded_condition_arguments, cond.get_truth()));
+            catch (...)
+            {
+                errors[i] = current_exception();
+            }
+        };
+        workers.emplace_back(work);
     }
-    for (const Condition cond : act.get_effects())
+    for (thread &worker : workers)
+        worker.join();
+    search_cancelled = false;
+
+    if (winner < 0)
     {
-        list<string> condition_arguments = cond.get_args();
-        list<string> grounded_condition_arguments = condition_arguments;
-        for (int i = 0; i < condition_arguments.size(); i++)
+        for (const exception_ptr &error : errors)
+            if (error)
+                rethrow_exception(error);
+        statistics.status = SEARCH_FAILED;
+        for (const PlannerStatistics &worker : worker_statistics)
         {
-            for (int j = 0; j < action_arguments.size(); j++)
+            if (worker.status == SEARCH_LIMIT_REACHED)
             {
-                if (*std::next(condition_arguments.begin(), i) == *std::next(action_arguments.begin(), j))
-                {
-                    *std::next(grounded_condition_arguments.begin(), i) = *std::next(arg.begin(), j);
-                }
+                statistics.status = SEARCH_LIMIT_REACHED;
+                statistics.limit = worker.limit;
             }
         }
-        effects.insert(GroundedCondition(cond.get_predicate(), grounded_condition_arguments, cond.get_truth()));
+        cout << "No Plan Found" << endl;
+        return list<GroundedAction>();
     }
-    return GroundedAction(act.get_name(), arg, preconditions, effects);
+    cout << "Portfolio Winner " << configurations[winner].first << ":" << configurations[winner].second << endl;
+    cout << "States Expanded " << winner_statistics.expanded << endl;
+    statistics.status = winner_statistics.status;
+    statistics.successor_time = winner_statistics.successor_time;
+    statistics.heuristic_time = winner_statistics.heuristic_time;
+    statistics.hashing_time = winner_statistics.hashing_time;
+    statistics.backtrack_time = winner_statistics.backtrack_time;
+    statistics.generated = winner_statistics.generated;
+    statistics.expanded = winner_statistics.expanded;
+    statistics.reopened = winner_statistics.reopened;
+    statistics.heuristic_cache_hits = winner_statistics.heuristic_cache_hits;
+    statistics.heuristic_cache_misses = winner_statistics.heuristic_cache_misses;
+    statistics.dead_ends = winner_statistics.dead_ends;
+    statistics.expected_omissions = winner_statistics.expected_omissions;
+    statistics.sat_conflicts = winner_statistics.sat_conflicts;
+    statistics.sat_decisions = winner_statistics.sat_decisions;
+    statistics.open_list_peak = winner_statistics.open_list_peak;
+    statistics.state_bytes = winner_statistics.state_bytes;
+    statistics.memory_samples = winner_statistics.memory_samples;
+    return winner_plan;
 }
 
-void getActionArgumentCombinations(grounded_action_set &grounded_actions, unordered_set<Action, ActionHasher, ActionComparator> &action_set, unordered_map<int, vector<list<string>>> &argument_permutations)
+// Search engine of the code emitted by generateDomainCode(); everything domain specific
+// comes from the Domain type it is instantiated on.
+const char *generated_engine = R"ENGINE(
+template <class State>
+struct GeneratedStateHash
 {
-    for (const Action &act : action_set)
+    size_t operator()(const State &state) const
     {
-        for (const list<string> &arg : argument_permutations[act.get_args().size()])
-        {
-            GroundedAction grounded_action = getGroundedAction(act, arg);
-            grounded_actions.insert(grounded_action);
-        }
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for (uint64_t word : state)
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        return hash ^ (hash >> 31);
     }
+};
+
+template <class Domain, class Visit, int... Ops>
+inline void forEachSuccessor(const typename Domain::State &state, Visit &visit, integer_sequence<int, Ops...>)
+{
+    (..., (Domain::template Operator<Ops>::applicable(state) ? visit(Ops, Domain::template Operator<Ops>::apply(state)) : void()));
 }
-string stateToString(const condition_set &node)
+
+// A* (heuristic 0) or greedy-weighted A* on 10 x unsatisfied goals (heuristic 1), like the
+// interpreting planner.
+template <class Domain>
+bool aStarSearch(int heuristic, vector<int> &plan, long &expanded)
 {
-    vector<string> state;
-    string stateString;
-    for (const auto &c : node)
+    typedef typename Domain::State State;
+    struct Entry
     {
-        state.push_back(c.toString());
-    }
-    sort(state.begin(), state.end());
-    for (const auto &c : state)
+        int g;
+        int parent;
+        int op;
+        bool closed;
+    };
+    vector<State> states;
+    vector<Entry> entries;
+    unordered_map<State, int, GeneratedStateHash<State>> ids;
+    typedef pair<int, int> OpenEntry; // (f, id)
+    priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry>> open_list;
+    auto h = [&](const State &state)
+    {
+        return heuristic == 1 ? 10 * Domain::unsatisfiedGoals(state) : 0;
+    };
+
+    states.push_back(Domain::initial);
+    entries.push_back(Entry{0, -1, -1, false});
+    ids[Domain::initial] = 0;
+    open_list.push(OpenEntry(h(Domain::initial), 0));
+    expanded = 0;
+    while (!open_list.empty())
     {
-        stateString += c;
+        int id = open_list.top().second;
+        open_list.pop();
+        if (entries[id].closed)
+            continue;
+        entries[id].closed = true;
+        if (Domain::unsatisfiedGoals(states[id]) == 0)
+        {
+            for (; entries[id].parent >= 0; id = entries[id].parent)
+                plan.push_back(entries[id].op);
+            reverse(plan.begin(), plan.end());
+            return true;
+        }
+        expanded++;
+        int g = entries[id].g + 1;
+        auto visit = [&](int op, const State &successor)
+        {
+            auto found = ids.find(successor);
+            if (found == ids.end())
+            {
+                int successor_id = states.size();
+                states.push_back(successor);
+                entries.push_back(Entry{g, id, op, false});
+                ids.emplace(successor, successor_id);
+                open_list.push(OpenEntry(g + h(successor), successor_id));
+            }
+            else if (!entries[found->second].closed && g < entries[found->second].g)
+            {
+                entries[found->second] = Entry{g, id, op, false};
+                open_list.push(OpenEntry(g + h(successor), found->second));
+            }
+        };
+        State state = states[id];
+        forEachSuccessor<Domain>(state, visit, make_integer_sequence<int, Domain::operators>());
     }
-    return stateString;
+    return false;
 }
 
-bool checkGoal(condition_set current, condition_set goal)
+int main(int argc, char *argv[])
 {
-    for (const auto &c : goal)
-    {
-        if (current.find(c) == current.end())
-            return false;
-    }
-    return true;
+    int heuristic = argc > 1 ? stoi(argv[1]) : 1;
+    vector<int> plan;
+    long expanded = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool solved = aStarSearch<GeneratedDomain>(heuristic, plan, expanded);
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "States Expanded " << expanded << endl;
+    cout << "Plan Took: " << time << " seconds" << endl;
+    cout << "Search Status: " << (solved ? "solved" : "unsolvable") << endl;
+    if (!solved)
+        return 2;
+    cout << "Plan Length: " << plan.size() << endl;
+    cout << endl
+         << "Plan: " << endl;
+    for (int op : plan)
+        cout << GeneratedDomain::operator_names[op] << " " << endl;
+    return 0;
 }
-struct Node
+)ENGINE";
+
+// Emits a self-contained C++ planner specialized for `task`: atom indices and the word
+// masks of every operator are compile-time constants, each operator is a specialization
+// of GeneratedDomain::Operator with unrolled applicability and effect code, and the
+// search is instantiated on GeneratedDomain.
+void generateDomainCode(const Task &task, const string &source, const string &filename)
 {
-    condition_set state_;
-    double g_value_;
-    double f_value_;
-    vector<GroundedAction> action_;
-    Node()
+    ofstream out(filename);
+    if (!out.is_open())
+        throw runtime_error("Unable to write " + filename);
+    const OperatorTable &ops = task.operators;
+    auto words = [&](const vector<int> &atoms, int begin, int end)
     {
-        g_value_ = 0;
-        f_value_ = 0;
-        action_ = vector<GroundedAction>{};
-    }
-    Node(condition_set state, vector<GroundedAction> action, double g_value, double f_value) : state_(state), action_(action), g_value_(g_value), f_value_(f_value) {}
-};
-struct CompareNode
-{
-    bool operator()(Node const &n1, Node const &n2)
+        map<int, uint64_t> masks;
+        for (int i = begin; i < end; i++)
+            masks[atoms[i] >> 6] |= uint64_t(1) << (atoms[i] & 63);
+        return masks;
+    };
+    auto stateLiteral = [&](const State &state)
     {
-        return n1.f_value_ > n2.f_value_;
+        stringstream literal;
+        literal << "{{";
+        for (int w = 0; w < task.state_words; w++)
+            literal << (w ? ", " : "") << "0x" << hex << state[w] << dec << "ull";
+        literal << "}}";
+        return literal.str();
+    };
+    State goal = emptyState(task);
+    for (int atom : task.goal_atoms)
+        addAtom(goal, atom);
+
+    out << "// Generated by planner --generate from " << source << "; specialized for its grounded task." << endl;
+    out << "// Build: g++ -O3 -std=c++17 -o <binary> " << filename << endl;
+    out << "// Usage: <binary> [heuristic]  (0: none, 1: 10 x unsatisfied goals)" << endl
+        << endl;
+    out << "#include <algorithm>\n#include <array>\n#include <chrono>\n#include <cstdint>\n#include <functional>\n"
+        << "#include <iostream>\n#include <queue>\n#include <string>\n#include <unordered_map>\n#include <utility>\n#include <vector>\n"
+        << endl;
+    out << "using namespace std;" << endl
+        << endl;
+    out << "struct GeneratedDomain" << endl
+        << "{" << endl;
+    out << "    static constexpr int atoms = " << task.atoms.size() << ";" << endl;
+    out << "    static constexpr int operators = " << ops.size() << ";" << endl;
+    out << "    static constexpr int words = " << task.state_words << ";" << endl;
+    out << "    typedef array<uint64_t, words> State;" << endl
+        << endl;
+    for (int atom = 0; atom < task.atoms.size(); atom++)
+        out << "    // atom " << atom << ": " << task.atoms.atoms[atom].toString() << endl;
+    out << "    static constexpr State initial = " << stateLiteral(task.initial_state) << ";" << endl;
+    out << "    static constexpr State goal = " << stateLiteral(goal) << ";" << endl;
+    out << "    static const char *const operator_names[operators];" << endl
+        << endl;
+    out << "    static int unsatisfiedGoals(const State &state)" << endl
+        << "    {" << endl
+        << "        int count = 0;" << endl;
+    for (int w = 0; w < task.state_words; w++)
+        if (goal[w])
+            out << "        count += __builtin_popcountll(goal[" << w << "] & ~state[" << w << "]);" << endl;
+    out << "        return count;" << endl
+        << "    }" << endl
+        << endl;
+    out << "    template <int Op>" << endl
+        << "    struct Operator;" << endl;
+    out << "};" << endl
+        << endl;
+
+    for (int op = 0; op < ops.size(); op++)
+    {
+        map<int, uint64_t> positive = words(ops.precondition_atoms, ops.precondition_begin[op], ops.precondition_begin[op + 1]);
+        map<int, uint64_t> negative = words(ops.negative_atoms, ops.negative_begin[op], ops.negative_begin[op + 1]);
+        map<int, uint64_t> adds = words(ops.add_atoms, ops.add_begin[op], ops.add_begin[op + 1]);
+        map<int, uint64_t> deletes = words(ops.delete_atoms, ops.delete_begin[op], ops.delete_begin[op + 1]);
+        out << "// " << getGroundedAction(task, op).toString() << endl;
+        out << "template <>" << endl
+            << "struct GeneratedDomain::Operator<" << op << ">" << endl
+            << "{" << endl;
+        out << "    static bool applicable(const State &state)" << endl
+            << "    {" << endl
+            << "        return true";
+        for (const pair<const int, uint64_t> &mask : positive)
+            out << hex << " && (state[" << dec << mask.first << "] & 0x" << hex << mask.second << "ull) == 0x" << mask.second << "ull" << dec;
+        for (const pair<const int, uint64_t> &mask : negative)
+            out << " && (state[" << mask.first << "] & 0x" << hex << mask.second << "ull) == 0" << dec;
+        out << ";" << endl
+            << "    }" << endl;
+        out << "    static State apply(State state)" << endl
+            << "    {" << endl;
+        set<int> touched;
+        for (const pair<const int, uint64_t> &mask : adds)
+            touched.insert(mask.first);
+        for (const pair<const int, uint64_t> &mask : deletes)
+            touched.insert(mask.first);
+        for (int w : touched)
+            out << "        state[" << w << "] = (state[" << w << "] & ~0x" << hex << deletes[w] << "ull) | 0x" << adds[w] << "ull;" << dec << endl;
+        out << "        return state;" << endl
+            << "    }" << endl
+            << "};" << endl
+            << endl;
     }
+    out << "const char *const GeneratedDomain::operator_names[operators] = {" << endl;
+    for (int op = 0; op < ops.size(); op++)
+        out << "    \"" << getGroundedAction(task, op).toString() << "\"," << endl;
+    out << "};" << endl;
+    out << generated_engine;
+}
+
+struct PartialOrderPlan
+{
+    vector<GroundedAction> steps;
+    vector<pair<int, int>> orderings; // (before, after) step indices, transitively reduced
+    vector<vector<int>> layers;       // steps that may run concurrently, in execution order
 };
 
-list<GroundedAction> backTrack(unordered_map<string, Node> &came_from, condition_set &start, Node goal)
+// Runs the configured search (a single engine or the portfolio) on `task`.
+list<GroundedAction> searchTask(const Task &task, int heuristic)
 {
-    list<GroundedAction> actions;
-    Node current_state = goal;
-    string start_state = stateToString(start);
-    while (stateToString(current_state.state_) != start_state) // Backtracking to get the shortest path
-    {
-        actions.push_back(current_state.action_[0]);
-        current_state = came_from[stateToString(current_state.state_)];
-    }
-    return actions;
+    if (options.search == "portfolio")
+        return portfolioSearch(task);
+    return runSearch(task, options.search, heuristic);
 }
-double getHeuristic(condition_set &current, condition_set &goal,int heuristic)
+
+// Orders the goals so that g comes before g' whenever g is reasonably ordered before g':
+// every operator achieving g deletes g' or needs an atom that cannot hold together with g'
+// (one mutex with g', or deleted by every achiever of g'), so achieving g' first would
+// force destroying it again. Orderings are taken in topological order, ties and cycles
+// broken by the order the goals were given in.
+vector<int> orderGoals(const Task &task)
 {
-    if(heuristic == 0){
-        return 0;
+    const OperatorTable &ops = task.operators;
+    vector<vector<int>> achievers(task.atoms.size());
+    for (int op = 0; op < ops.size(); op++)
+        for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+            if (task.is_goal[ops.add_atoms[i]])
+                achievers[ops.add_atoms[i]].push_back(op);
+
+    int goals = task.goal_atoms.size();
+    // excluded[g][atom]: atom cannot hold right after g is achieved
+    vector<vector<char>> excluded(goals, vector<char>(task.atoms.size(), 0));
+    for (int g = 0; g < goals; g++)
+    {
+        int goal = task.goal_atoms[g];
+        for (const vector<int> &group : task.mutex_groups)
+            if (find(group.begin(), group.end(), goal) != group.end())
+                for (int atom : group)
+                    excluded[g][atom] = atom != goal;
+        const vector<int> &ops_g = achievers[goal];
+        vector<int> deleted_by_all(task.atoms.size(), 0);
+        for (int op : ops_g)
+            for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+                deleted_by_all[ops.delete_atoms[i]]++;
+        for (int atom = 0; atom < task.atoms.size(); atom++)
+            if (!ops_g.empty() && deleted_by_all[atom] == (int)ops_g.size())
+                excluded[g][atom] = 1;
     }
-    if (heuristic == 1){
-        double count = 0;
-        int weight = 10;
-        for (const auto &goal_condition : goal)
+    auto inconsistent = [&](int op, int g)
+    {
+        int goal = task.goal_atoms[g];
+        for (int i = ops.add_begin[op]; i < ops.add_begin[op + 1]; i++)
+            if (ops.add_atoms[i] == goal)
+                return false;
+        for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1]; i++)
+            if (ops.delete_atoms[i] == goal)
+                return true;
+        for (int i = ops.precondition_begin[op]; i < ops.precondition_begin[op + 1]; i++)
+            if (excluded[g][ops.precondition_atoms[i]])
+                return true;
+        return false;
+    };
+
+    vector<vector<int>> successors(goals);
+    vector<int> predecessors(goals, 0);
+    for (int g = 0; g < goals; g++)
+    {
+        const vector<int> &ops_g = achievers[task.goal_atoms[g]];
+        if (ops_g.empty())
+            continue;
+        for (int other = 0; other < goals; other++)
         {
-            if (current.find(goal_condition) == current.end())
-                count++;
+            if (other == g)
+                continue;
+            bool ordered = true;
+            for (size_t i = 0; i < ops_g.size() && ordered; i++)
+                ordered = inconsistent(ops_g[i], other);
+            if (ordered)
+            {
+                successors[g].push_back(other);
+                predecessors[other]++;
+            }
         }
-        return weight*count;
     }
-    return 0;
+    vector<int> order;
+    vector<char> placed(goals, 0);
+    while ((int)order.size() < goals)
+    {
+        int next = -1;
+        for (int g = 0; g < goals && next < 0; g++)
+            if (!placed[g] && predecessors[g] == 0)
+                next = g;
+        for (int g = 0; g < goals && next < 0; g++)
+            if (!placed[g])
+                next = g;
+        placed[next] = 1;
+        order.push_back(task.goal_atoms[next]);
+        for (int other : successors[next])
+            predecessors[other]--;
+    }
+    return order;
 }
 
-void expandActionsAndArgumentsHeuristic(priority_queue<Node, vector<Node>, CompareNode> &open_list, unordered_map<string, double> &g_value_list,
-                               unordered_set<string> &closed_list, grounded_action_set &grounded_actions, unordered_map<string, Node> &came_from,
-                               Node &current_node, Node &goal_node, double edge_cost)
+// Deletes go before adds, as in applyAction, so an atom both deleted and added stays true.
+State applyPlan(const Task &task, State state, const list<GroundedAction> &plan)
 {
-    for (const GroundedAction &grounded_action : grounded_actions)
+    for (const GroundedAction &action : plan)
     {
-        if (checkPreconditions(current_node.state_, grounded_action.get_preconditions()))
+        for (bool truth : {false, true})
         {
-            condition_set neighbour = applyActionHeuristic(current_node.state_, grounded_action.get_effects());
-            string neighbour_string = stateToString(neighbour);
-            if (closed_list.find(neighbour_string) == closed_list.end())
+            for (const GroundedCondition &effect : action.get_effects())
             {
-                double neighbour_g_value = current_node.g_value_ + edge_cost;
-                auto neighbour_openlist = g_value_list.find(neighbour_string);
-                if (neighbour_openlist == g_value_list.end() || neighbour_g_value < neighbour_openlist->second)
-                {
-                    Node neighbour_node = Node(neighbour, vector<GroundedAction>{grounded_action}, neighbour_g_value, INT_MAX);
-                    neighbour_node.f_value_ = neighbour_node.g_value_;
-                    open_list.push(neighbour_node);
-                    g_value_list[neighbour_string] = neighbour_g_value;
-                    came_from[neighbour_string] = current_node;
-                }
+                int atom = task.atoms.find(effect.toString());
+                if (atom < 0 || effect.get_truth() != truth)
+                    continue;
+                if (truth)
+                    addAtom(state, atom);
+                else
+                    deleteAtom(state, atom);
             }
         }
     }
+    return state;
 }
 
+// Copy of `task` starting in `start` with only `goals`; operators that delete a protected
+// atom (without adding it back) are dropped.
+Task subTask(const Task &task, const State &start, const vector<int> &goals, const vector<int> &protected_atoms)
+{
+    Task sub;
+    sub.atoms = task.atoms;
+    sub.initial_state = start;
+    sub.goal_atoms = goals;
+    sub.is_goal.assign(task.atoms.size(), 0);
+    for (int atom : goals)
+        sub.is_goal[atom] = 1;
+    sub.state_words = task.state_words;
+    sub.mutex_groups = task.mutex_groups;
+    sub.encoding = task.encoding;
 
-double getAdmissibleHeuristic(grounded_action_set& grounded_actions,condition_set& start,condition_set& goal){
-    Node start_node = Node(start, vector<GroundedAction>{}, 0, 0);
-    Node goal_node = Node(goal, vector<GroundedAction>{}, 0, 0);
-    Node current_node = start_node;
-    unordered_map<string, Node> came_from;
-    priority_queue<Node, vector<Node>, CompareNode> open_list;
-    unordered_set<string> closed_list;
-    unordered_map<string, double> g_value_list;
-    double edge_cost = 1;
-    string current_node_string;
-    open_list.push(start_node);
-    g_value_list[stateToString(start_node.state_)] = start_node.g_value_;
-    while (!open_list.empty())
+    vector<char> is_protected(task.atoms.size(), 0);
+    for (int atom : protected_atoms)
+        is_protected[atom] = 1;
+    const OperatorTable &ops = task.operators;
+    OperatorTable &kept = sub.operators;
+    for (int op = 0; op < ops.size(); op++)
     {
-        current_node = open_list.top();
-        open_list.pop();
-        current_node_string = stateToString(current_node.state_);
-        closed_list.insert(current_node_string);
-        if (checkGoal(current_node.state_, goal))
+        bool destroys = false;
+        for (int i = ops.delete_begin[op]; i < ops.delete_begin[op + 1] && !destroys; i++)
         {
-            goal_node = current_node;
-            break;
+            int atom = ops.delete_atoms[i];
+            destroys = is_protected[atom] &&
+                       find(ops.add_atoms.begin() + ops.add_begin[op], ops.add_atoms.begin() + ops.add_begin[op + 1], atom) == ops.add_atoms.begin() + ops.add_begin[op + 1];
+        }
+        if (destroys)
+            continue;
+        kept.names.push_back(ops.names[op]);
+        kept.arguments.push_back(ops.arguments[op]);
+        kept.precondition_atoms.insert(kept.precondition_atoms.end(), ops.precondition_atoms.begin() + ops.precondition_begin[op], ops.precondition_atoms.begin() + ops.precondition_begin[op + 1]);
+        kept.negative_atoms.insert(kept.negative_atoms.end(), ops.negative_atoms.begin() + ops.negative_begin[op], ops.negative_atoms.begin() + ops.negative_begin[op + 1]);
+        kept.add_atoms.insert(kept.add_atoms.end(), ops.add_atoms.begin() + ops.add_begin[op], ops.add_atoms.begin() + ops.add_begin[op + 1]);
+        kept.delete_atoms.insert(kept.delete_atoms.end(), ops.delete_atoms.begin() + ops.delete_begin[op], ops.delete_atoms.begin() + ops.delete_begin[op + 1]);
+        kept.precondition_begin.push_back(kept.precondition_atoms.size());
+        kept.negative_begin.push_back(kept.negative_atoms.size());
+        kept.add_begin.push_back(kept.add_atoms.size());
+        kept.delete_begin.push_back(kept.delete_atoms.size());
+    }
+    finalizeTask(sub);
+    return sub;
+}
+
+// Satisficing goal serialization: goals are taken in reasonable order and each is planned
+// for from the end state of the previous subplan, keeping all goals achieved so far. The
+// first attempt drops operators that would destroy those goals; if that subproblem has no
+// plan they may be destroyed temporarily, as long as they hold again at its end.
+list<GroundedAction> serializedGoalSearch(const Task &task, int heuristic)
+{
+    vector<int> order = orderGoals(task);
+    cout << "Goal Order:";
+    for (int atom : order)
+        cout << " " << task.atoms.atoms[atom].toString();
+    cout << endl;
+
+    list<GroundedAction> plan;
+    State state = task.initial_state;
+    vector<int> achieved;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        vector<int> goals = achieved;
+        goals.push_back(order[i]);
+        achieved = goals;
+        if (holds(state, order[i]))
+            continue;
+        list<GroundedAction> subplan;
+        for (bool protect : {true, false})
+        {
+            relaxed_distance_cache.clear();
+            statistics.status = SEARCH_RUNNING;
+            subplan = searchTask(subTask(task, state, goals, protect ? goals : vector<int>()), heuristic);
+            if (statistics.status != SEARCH_UNSOLVABLE && statistics.status != SEARCH_FAILED)
+                break;
+        }
+        if (statistics.status != SEARCH_SOLVED)
+        {
+            // unsolvable from an intermediate state says nothing about the whole task
+            if (statistics.status == SEARCH_UNSOLVABLE)
+                statistics.status = SEARCH_FAILED;
+            return list<GroundedAction>();
         }
-        expandActionsAndArgumentsHeuristic(open_list, g_value_list, closed_list, grounded_actions, came_from, current_node, goal_node, edge_cost);
+        cout << "Subgoal " << i + 1 << "/" << order.size() << ": " << task.atoms.atoms[order[i]].toString()
+             << " (" << subplan.size() << " steps)" << endl;
+        state = applyPlan(task, state, subplan);
+        plan.splice(plan.end(), subplan);
     }
-    list<GroundedAction> actions = backTrack(came_from, start, goal_node);
-    return actions.size();
+    relaxed_distance_cache.clear();
+    statistics.status = SEARCH_SOLVED;
+    return plan;
 }
 
-void expandActionsAndArguments(priority_queue<Node, vector<Node>, CompareNode> &open_list, unordered_map<string, double> &g_value_list,
-                               unordered_set<string> &closed_list, grounded_action_set &grounded_actions, unordered_map<string, Node> &came_from,
-                               Node &current_node, Node &goal_node, double edge_cost,int heuristic)
+// Deorders a sequential plan. Every precondition (and goal) of a step is supported by its
+// last achiever earlier in the plan; steps that would undo that support are ordered before
+// the achiever if they came before it, after the consumer otherwise. Every linearization of
+// the resulting partial order is a valid plan. Layers group steps by longest ordering chain.
+PartialOrderPlan deorderPlan(const list<GroundedAction> &plan, const condition_set &goal)
 {
-    for (const GroundedAction &grounded_action : grounded_actions)
+    PartialOrderPlan result;
+    result.steps.assign(plan.begin(), plan.end());
+    int steps = result.steps.size();
+
+    // requirements[j] for step j, and for the goal as step `steps`; effects[i] per step, with
+    // adds recorded after deletes so an atom both deleted and added is set true, as in applyAction
+    vector<vector<pair<string, bool>>> requirements(steps + 1);
+    vector<unordered_map<string, bool>> effects(steps);
+    for (int i = 0; i < steps; i++)
+    {
+        for (const GroundedCondition &pre : result.steps[i].get_preconditions())
+            requirements[i].push_back(make_pair(pre.toString(), pre.get_truth()));
+        for (bool truth : {false, true})
+            for (const GroundedCondition &effect : result.steps[i].get_effects())
+                if (effect.get_truth() == truth)
+                    effects[i][effect.toString()] = truth;
+    }
+    for (const GroundedCondition &atom : goal)
+        requirements[steps].push_back(make_pair(atom.toString(), atom.get_truth()));
+
+    vector<vector<bool>> before(steps + 1, vector<bool>(steps + 1, false));
+    auto sets = [&](int step, const string &atom, bool truth)
+    {
+        auto effect = effects[step].find(atom);
+        return effect != effects[step].end() && effect->second == truth;
+    };
+    for (int consumer = 0; consumer <= steps; consumer++)
     {
-        if (checkPreconditions(current_node.state_, grounded_action.get_preconditions()))
+        for (const pair<string, bool> &requirement : requirements[consumer])
         {
-            condition_set neighbour = applyAction(current_node.state_, grounded_action.get_effects());
-            string neighbour_string = stateToString(neighbour);
-            if (closed_list.find(neighbour_string) == closed_list.end())
+            int producer = -1; // the initial state
+            for (int i = consumer - 1; i >= 0 && producer < 0; i--)
+                if (sets(i, requirement.first, requirement.second))
+                    producer = i;
+            if (producer >= 0)
+                before[producer][consumer] = true;
+            for (int threat = 0; threat < steps; threat++)
             {
-                double neighbour_g_value = current_node.g_value_ + edge_cost;
-                auto neighbour_openlist = g_value_list.find(neighbour_string);
-                if (neighbour_openlist == g_value_list.end() || neighbour_g_value < neighbour_openlist->second)
-                {
-                    Node neighbour_node = Node(neighbour, vector<GroundedAction>{grounded_action}, neighbour_g_value, INT_MAX);
-                    if (heuristic == 2)
-                        neighbour_node.f_value_ = neighbour_node.g_value_ + getAdmissibleHeuristic(grounded_actions,neighbour_node.state_,goal_node.state_);
-                    else 
-                        neighbour_node.f_value_ = neighbour_node.g_value_ + getHeuristic(neighbour, goal_node.state_,heuristic);
-                    open_list.push(neighbour_node);
-                    g_value_list[neighbour_string] = neighbour_g_value;
-                    came_from[neighbour_string] = current_node;
-                }
+                if (threat == consumer || !sets(threat, requirement.first, !requirement.second))
+                    continue;
+                if (threat < producer)
+                    before[threat][producer] = true;
+                else if (threat > consumer)
+                    before[consumer][threat] = true;
             }
         }
     }
-}
 
+    // Edges only point forward in the plan, so one pass in plan order closes them.
+    vector<vector<bool>> reachable = before;
+    for (int j = 0; j < steps; j++)
+        for (int i = j - 1; i >= 0; i--)
+            if (reachable[i][j])
+                for (int k = j + 1; k < steps; k++)
+                    if (reachable[j][k])
+                        reachable[i][k] = true;
+
+    vector<int> layer(steps, 0);
+    for (int j = 0; j < steps; j++)
+    {
+        for (int i = 0; i < j; i++)
+        {
+            if (!reachable[i][j])
+                continue;
+            layer[j] = max(layer[j], layer[i] + 1);
+            bool implied = false;
+            for (int k = i + 1; k < j && !implied; k++)
+                implied = reachable[i][k] && reachable[k][j];
+            if (!implied)
+                result.orderings.push_back(make_pair(i, j));
+        }
+        if (layer[j] >= (int)result.layers.size())
+            result.layers.resize(layer[j] + 1);
+        result.layers[layer[j]].push_back(j);
+    }
+    return result;
+}
 
+void printPartialOrderPlan(const PartialOrderPlan &plan)
+{
+    cout << "\nParallel Plan: " << plan.layers.size() << " layers for " << plan.steps.size() << " steps" << endl;
+    for (size_t l = 0; l < plan.layers.size(); l++)
+    {
+        cout << "Layer " << l << ":";
+        for (int step : plan.layers[l])
+            cout << " " << step << ":" << plan.steps[step].toString();
+        cout << endl;
+    }
+    cout << "Orderings:";
+    for (const pair<int, int> &ordering : plan.orderings)
+        cout << " " << ordering.first << "<" << ordering.second;
+    cout << endl;
+}
 
-list<GroundedAction> planner(Env *env,int heuristic)
+// Plans for `env`, or with a non-empty `generate_file` writes a planner specialized for its
+// grounded task there and returns with status SEARCH_GENERATED.
+list<GroundedAction> planner(Env *env,int heuristic, const string &source, const string &generate_file)
 {
     // this is where you insert your planner
-    condition_set start = env->get_inital_conditions();
-    condition_set goal = env->get_goal_conditions();
-    unordered_set<Action, ActionHasher, ActionComparator> action_set = env->get_all_actions();
-    vector<string> arguments = get_arguements(start);
+    planner_start = chrono::steady_clock::now();
+    relaxed_distance_cache.clear(); // distances of an earlier task in a problem stream
+    string macro_file;
+    if (!options.macro_directory.empty())
+    {
+        macro_file = options.macro_directory + "/" + MacroLibrary::domainKey(env) + ".macros";
+        macro_library.load(macro_file);
+    }
+    Task task = buildTask(env);
+    statistics.grounded_actions = task.operators.size();
+    cout << "Grounding Took: " << statistics.grounding_time << " seconds" << endl;
+    cout << "Grounded Actions " << task.operators.size() << endl;
+    cout << "Mutex Groups " << task.mutex_groups.size() << endl;
+    cout << "State Variables " << task.encoding.variable_atoms.size() << " (" << task.encoding.packed_bytes << " bytes per state, "
+         << task.atoms.size() << " atoms)" << endl;
+    if (!generate_file.empty())
+    {
+        generateDomainCode(task, source, generate_file);
+        cout << "Generated " << generate_file << endl;
+        statistics.status = SEARCH_GENERATED;
+        return list<GroundedAction>();
+    }
+    if (!goalRelaxedReachable(task, task.initial_state))
+    {
+        cout << "Goal Relaxed-Unreachable" << endl;
+        statistics.status = SEARCH_UNSOLVABLE;
+        statistics.plan_length = 0;
+        return list<GroundedAction>();
+    }
+    ScopedTimer search_timer(statistics.search_time);
+    list<GroundedAction> actions;
+    if (options.serialize_goals)
+        actions = serializedGoalSearch(task, heuristic);
+    else
+        actions = searchTask(task, heuristic);
+    if (!macro_file.empty() && statistics.status == SEARCH_SOLVED)
+    {
+        actions = macro_library.expand(env, actions);
+        macro_library.learn(env, actions);
+        macro_library.save(macro_file);
+    }
+    statistics.plan_length = actions.size();
+    return actions;
+}
 
-    vector<pair<string, int>> action_names = getActionNames(action_set);
-    unordered_map<int, vector<list<string>>> argument_permutations;
-    for (int i = 0; i < action_names.size(); i++)
+// Prints the outcome of planner() and returns the exit code: 0 solved or generated, 2
+// unsolvable, 3 limit reached, 1 any other failure.
+int printResult(Env *env, const list<GroundedAction> &actions, double time)
+{
+    cout << "Plan Took: " << time << " seconds\n";
+    cout << "Search Status: " << searchStatusName(statistics.status);
+    if (statistics.status == SEARCH_LIMIT_REACHED)
+        cout << " (" << statistics.limit << ")";
+    cout << "\n";
+    if (statistics.status == SEARCH_SOLVED)
     {
-        if (argument_permutations.find(action_names[i].second) == argument_permutations.end())
+        cout << "Plan Length: " << actions.size() << "\n";
+        cout << "\nPlan: " << endl;
+
+        for (GroundedAction gac : actions)
         {
-            argument_permutations[action_names[i].second] = getPermuations(arguments, action_names[i].second);
+            cout << gac << endl;
         }
+        if (options.parallel_plan)
+            printPartialOrderPlan(deorderPlan(actions, env->get_goal_conditions()));
     }
-    grounded_action_set grounded_actions;
-    unordered_map<string, Node> came_from;
-    getActionArgumentCombinations(grounded_actions, action_set, argument_permutations);
-    Node start_node = Node(start, vector<GroundedAction>{}, 0, getHeuristic(start, goal,heuristic));
-    Node goal_node = Node(goal, vector<GroundedAction>{}, INT_MAX, 0);
-    Node current_node = start_node;
-    priority_queue<Node, vector<Node>, CompareNode> open_list;
-    unordered_set<string> closed_list;
-    unordered_map<string, double> g_value_list;
-    double edge_cost = 1;
-    string current_node_string;
-    open_list.push(start_node);
-    g_value_list[stateToString(start_node.state_)] = start_node.g_value_;
-    while (!open_list.empty())
+    switch (statistics.status)
     {
-        current_node = open_list.top();
-        open_list.pop();
-        current_node_string = stateToString(current_node.state_);
-        closed_list.insert(current_node_string);
-        if (checkGoal(current_node.state_, goal))
+    case SEARCH_SOLVED:
+    case SEARCH_GENERATED:
+        return 0;
+    case SEARCH_UNSOLVABLE:
+        return 2;
+    case SEARCH_LIMIT_REACHED:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+// Loads the action schemas of `domain_file` once, then plans for each problem (symbols,
+// initial and goal conditions) read from options.problems_file ("-" for stdin) and prints
+// its plan as soon as it is found, so the stream may be a pipe still being written.
+// Invariant synthesis, which only depends on the schemas, runs once for all problems.
+// With --stats, problem i writes its report to <file>.i. Returns 0 when every problem is
+// solved and otherwise the exit code of the first one that was not.
+int solveProblemStream(const string &domain_file, int heuristic)
+{
+    Env domain;
+    {
+        ScopedTimer timer(statistics.parse_time);
+        ifstream domain_input(domain_file);
+        if (!domain_input.is_open())
+            throw runtime_error("Unable to open domain " + domain_file);
+        parseEnvironment(domain_input, &domain, ACTIONS, false);
+    }
+    unordered_set<Action, ActionHasher, ActionComparator> schemas = domain.get_all_actions();
+    vector<Invariant> invariants = synthesizeInvariants(schemas);
+    domain_invariants = &invariants;
+    cout << "Domain: " << domain_file << " (" << schemas.size() << " actions, " << invariants.size() << " invariants)" << endl;
+
+    ifstream problem_file;
+    istream *problems = &cin;
+    if (options.problems_file != "-")
+    {
+        problem_file.open(options.problems_file);
+        if (!problem_file.is_open())
+            throw runtime_error("Unable to open problems " + options.problems_file);
+        problems = &problem_file;
+    }
+    int exit_code = 0;
+    for (int problem = 1;; problem++)
+    {
+        Env env;
+        for (const Action &act : schemas)
+            env.add_action(act);
+        statistics = PlannerStatistics();
         {
-            cout << "Path Found" << endl;
-            goal_node = current_node;
-            break;
+            ScopedTimer timer(statistics.parse_time);
+            if (!parseEnvironment(*problems, &env, SYMBOLS, true))
+                break;
+        }
+        cout << endl
+             << "Problem " << problem << endl;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        string generate_file = options.generate_file;
+        if (!generate_file.empty())
+        {
+            size_t extension = generate_file.rfind('.');
+            size_t slash = generate_file.rfind('/');
+            if (extension == string::npos || (slash != string::npos && extension < slash))
+                extension = generate_file.size();
+            generate_file.insert(extension, "." + to_string(problem));
         }
-        expandActionsAndArguments(open_list, g_value_list, closed_list, grounded_actions, came_from, current_node, goal_node, edge_cost,heuristic);
+        list<GroundedAction> actions = planner(&env, heuristic, options.problems_file, generate_file);
+        double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        int problem_exit_code = printResult(&env, actions, time);
+        cout << flush;
+        if (exit_code == 0)
+            exit_code = problem_exit_code;
+        if (!options.stats_file.empty())
+            writeStatistics(options.stats_file + "." + to_string(problem));
     }
-    cout << "States Expanded " << closed_list.size() << endl;
-    cout << "Backtracking" << endl;
-    list<GroundedAction> actions = backTrack(came_from, start, goal_node);
-    actions.reverse();
-    return actions;
+    domain_invariants = nullptr;
+    return exit_code;
+}
+
+// Parses the --key=value options that follow the positional <problem> <heuristic>
+// arguments.
+PlannerOptions parseOptions(int argc, char *argv[])
+{
+    PlannerOptions parsed;
+    for (int i = 3; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option.rfind("--stats=", 0) == 0)
+            parsed.stats_file = option.substr(8);
+        else if (option.rfind("--search=", 0) == 0)
+            parsed.search = option.substr(9);
+        else if (option.rfind("--external-dir=", 0) == 0)
+            parsed.external_directory = option.substr(15);
+        else if (option.rfind("--buffer-mb=", 0) == 0)
+            parsed.external_buffer_mb = stoul(option.substr(12));
+        else if (option.rfind("--beam-width=", 0) == 0)
+            parsed.beam_width = stoul(option.substr(13));
+        else if (option.rfind("--walks=", 0) == 0)
+            parsed.walks = stoi(option.substr(8));
+        else if (option.rfind("--walk-length=", 0) == 0)
+            parsed.walk_length = stoi(option.substr(14));
+        else if (option.rfind("--walk-threads=", 0) == 0)
+            parsed.walk_threads = stoi(option.substr(15));
+        else if (option.rfind("--walk-restarts=", 0) == 0)
+            parsed.walk_restarts = stoi(option.substr(16));
+        else if (option.rfind("--width=", 0) == 0)
+        {
+            parsed.width = stoi(option.substr(8));
+            if (parsed.width < 1 || parsed.width > 2)
+                throw invalid_argument("Unsupported width " + option.substr(8) + ", use 1 or 2");
+        }
+        else if (option.rfind("--memory-budget=", 0) == 0)
+            parsed.memory_budget = parseByteSize(option.substr(16));
+        else if (option.rfind("--portfolio=", 0) == 0)
+            parsed.portfolio = option.substr(12);
+        else if (option.rfind("--time-limit=", 0) == 0)
+            parsed.time_limit = stod(option.substr(13));
+        else if (option.rfind("--expansion-limit=", 0) == 0)
+            parsed.expansion_limit = stol(option.substr(18));
+        else if (option.rfind("--memory-limit=", 0) == 0)
+            parsed.memory_limit = parseByteSize(option.substr(15));
+        else if (option.rfind("--progress=", 0) == 0)
+            parsed.progress_interval = stod(option.substr(11));
+        else if (option == "--parallel-plan")
+            parsed.parallel_plan = true;
+        else if (option.rfind("--sat-growth=", 0) == 0)
+            parsed.sat_horizon_growth = stod(option.substr(13));
+        else if (option.rfind("--sat-max-horizon=", 0) == 0)
+            parsed.sat_max_horizon = stoi(option.substr(18));
+        else if (option.rfind("--ground-threads=", 0) == 0)
+            parsed.grounding_threads = stoi(option.substr(17));
+        else if (option.rfind("--problems=", 0) == 0)
+            parsed.problems_file = option.substr(11);
+        else if (option.rfind("--generate=", 0) == 0)
+            parsed.generate_file = option.substr(11);
+        else if (option.rfind("--macros=", 0) == 0)
+            parsed.macro_directory = option.substr(9);
+        else if (option == "--dead-end-pruning")
+            parsed.dead_end_pruning = true;
+        else if (option == "--serialize-goals")
+            parsed.serialize_goals = true;
+        else if (option.rfind("--bitstate=", 0) == 0)
+            parsed.bitstate_bytes = parseByteSize(option.substr(11));
+        else if (option.rfind("--bitstate-hashes=", 0) == 0)
+            parsed.bitstate_hashes = stoi(option.substr(18));
+        else if (option.rfind("--h-cache=", 0) == 0)
+            parsed.heuristic_cache_bytes = parseByteSize(option.substr(10));
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    return parsed;
 }
+
 int main(int argc, char *argv[])
 {
-    // DO NOT CHANGE THIS FUNCTION
+    // Positional arguments: <problem> <heuristic>; everything else goes through parseOptions()
     char *filename = (char *)("fire.txt");
     int heuristic = 1; // 0 Dijsktra(No Heuristic) 1 Inadmissble Heuristic 2 Admissble Heuristic
     if (argc > 1){
         filename = argv[1];
         heuristic = stoi(argv[2]);
     }
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const invalid_argument &error)
+    {
+        cout << error.what() << endl;
+        return 1;
+    }
+
+    if (!options.problems_file.empty())
+        return solveProblemStream(filename, heuristic);
 
     cout << "Environment: " << filename << endl
          << endl;
-    Env *env = create_env(filename);
+    Env *env;
+    {
+        ScopedTimer timer(statistics.parse_time);
+        env = create_env(filename);
+    }
     if (print_status)
     {
         cout << *env;
     }
 
     std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
-    list<GroundedAction> actions = planner(env,heuristic);
+    list<GroundedAction> actions = planner(env,heuristic, filename, options.generate_file);
     std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> time_span = t2 - t1;
     double time = time_span.count()/1000.0;
-    cout << "Plan Took: " << time << " seconds\n";
-    cout << "Plan Length: " << actions.size() << "\n";
-    cout << "\nPlan: " << endl;
-
-    for (GroundedAction gac : actions)
-    {
-        cout << gac << endl;
-    }
-    return 0;
-}
\ No newline at end of file
+    int exit_code = printResult(env, actions, time);
+    if (!options.stats_file.empty())
+        writeStatistics(options.stats_file);
+    return exit_code;
+}